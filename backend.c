@@ -16,6 +16,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
+#include <string.h>
+
+#include "backend.h"
 #include "expr.h"
 #include "log.h"
 #include "map.h"
@@ -40,6 +44,12 @@ struct context_s
 };
 typedef struct context_s *context_t;
 
+/*
+ * Incremental (session) context.
+ */
+static struct context_s backend_session;
+static bool backend_session_init = false;
+
 /*
  * Prototypes.
  */
@@ -68,6 +78,57 @@ extern bool backend(const char *filename, size_t lineno, expr_t s, expr_t t)
     return !cxt->error;
 }
 
+/*
+ * Incremental solver backend.  Same as backend(), except that the SAT
+ * literals and solver variables persist between calls.
+ */
+extern bool backend_add(const char *filename, size_t lineno, expr_t s,
+    expr_t t)
+{
+    if (!backend_session_init)
+        backend_reset();
+    context_t cxt = &backend_session;
+    cxt->error = false;
+    cxt->file = filename;
+    cxt->line = lineno;
+
+    backend_theory(cxt, t);
+    backend_clauses(cxt, s);
+
+    return !cxt->error;
+}
+
+/*
+ * Get the SAT literal of a Boolean variable from the incremental context
+ * (creating one if need be).
+ */
+extern literal_t backend_literal(var_t v)
+{
+    if (!backend_session_init)
+        backend_reset();
+    expr_t e = expr_var(v);
+    return backend_sat_literal(&backend_session, e);
+}
+
+/*
+ * Reset the incremental context.
+ */
+extern void backend_reset(void)
+{
+    if (!backend_session_init)
+    {
+        if (!gc_root(&backend_session, sizeof(backend_session)))
+            panic("failed to set GC root for backend session: %s",
+                strerror(errno));
+        backend_session_init = true;
+    }
+    backend_session.varlits = varlits_init();
+    backend_session.varvars = varvars_init();
+    backend_session.error = false;
+    backend_session.file = NULL;
+    backend_session.line = 0;
+}
+
 /****************************************************************************/
 /* THEORY                                                                   */
 /****************************************************************************/
@@ -171,7 +232,11 @@ static void backend_theory_iff(context_t cxt, expr_t e)
     sym_t sym = make_sym(atom_name(f->atom), atom_arity(f->atom), true);
     typesig_t sig = typeinst_lookup_typesig(f->atom);
     register_typesig(sym, sig);
-    cons_t c = make_cons_a(NULL, sym, args);
+    // In incremental mode the variables may have been bound by an earlier
+    // query.  Such bindings are at level 0 (see sat_rewind()), so any
+    // antecedents pushed onto the reason are true and can be discarded.
+    reason_t reason = make_reason();
+    cons_t c = make_cons_a(reason, sym, args);
     var_t b = expr_getvar(d);
     backend_insert_sat_literal(cxt, b, c->b);
 }
@@ -21,6 +21,7 @@
 #include <stdbool.h>
 
 #include "expr.h"
+#include "sat.h"
 #include "term.h"
 
 /*
@@ -28,4 +29,13 @@
  */
 extern bool backend(const char *filename, size_t lineno, expr_t s, expr_t e);
 
+/*
+ * Incremental solver backend.  The variables of successive goals are shared
+ * (until the next backend_reset()), so goals can be loaded one at a time.
+ */
+extern bool backend_add(const char *filename, size_t lineno, expr_t s,
+    expr_t e);
+extern literal_t backend_literal(var_t v);
+extern void backend_reset(void);
+
 #endif      /* __BACKEND_H */
@@ -0,0 +1,416 @@
+/*
+ * dimacs.c
+ * Copyright (C) 2018 National University of Singapore
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "debug.h"
+#include "dimacs.h"
+#include "log.h"
+#include "misc.h"
+#include "options.h"
+#include "portfolio.h"
+#include "sat.h"
+#include "smchr.h"
+#include "solver.h"
+#include "stats.h"
+
+#define DIMACS_BUFFER_SIZE      0x3FFFFFFF
+#define DIMACS_LINE_LENGTH      78
+
+/*
+ * DIMACS state.
+ */
+static bvar_t *dimacs_vars;     // DIMACS variable -> SAT variable.
+static size_t dimacs_vars_len;  // Number of DIMACS variables.
+static int32_t *dimacs_marks;   // Per-variable clause marks.
+static literal_t *dimacs_lits;  // Current clause.
+
+/*
+ * Prototypes.
+ */
+static const char *dimacs_read(const char *filename, size_t *size,
+    bool *mapped);
+static bool dimacs_parse(const char *filename, const char *buf, size_t size);
+static void dimacs_add_clause(literal_t *lits, size_t len, int32_t clause,
+    size_t lineno);
+static void dimacs_print_model(void);
+static const char *dimacs_skip_blanks(const char *ptr, const char *end);
+static bool dimacs_parse_num(const char **ptr, const char *end, size_t *n);
+static void dimacs_make_vars(size_t num_vars);
+
+/*
+ * Test if the given file starts with a DIMACS header.
+ */
+extern bool dimacs_detect(const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (file == NULL)
+        return false;
+    int c;
+    while (true)
+    {
+        c = getc(file);
+        if (isspace(c))
+            continue;
+        if (c != 'c')
+            break;
+        while (c != '\n' && c != EOF)
+            c = getc(file);
+    }
+    bool found = false;
+    if (c == 'p' && isspace(c = getc(file)))
+    {
+        while (isspace(c))
+            c = getc(file);
+        found = (c == 'c' && getc(file) == 'n' && getc(file) == 'f' &&
+            isspace(getc(file)));
+    }
+    fclose(file);
+    return found;
+}
+
+/*
+ * Solve a DIMACS CNF problem.
+ */
+extern int dimacs_solve(const char *filename)
+{
+    smchr_init();
+    option_debug_on = option_debug;
+    stats_reset();
+
+    if (dimacs_vars == NULL)
+    {
+        dimacs_vars  = (bvar_t *)buffer_alloc(DIMACS_BUFFER_SIZE);
+        dimacs_marks = (int32_t *)buffer_alloc(DIMACS_BUFFER_SIZE);
+        dimacs_lits  = (literal_t *)buffer_alloc(DIMACS_BUFFER_SIZE);
+    }
+    dimacs_vars_len = 0;
+
+    // (1) Load the clauses:
+    size_t size;
+    bool mapped;
+    const char *name = (filename == NULL? "<stdin>": filename);
+    const char *buf = dimacs_read(filename, &size, &mapped);
+    bool ok = dimacs_parse(name, buf, size);
+#ifndef WINDOWS
+    if (mapped)
+        munmap((void *)buf, size);
+    else
+#endif
+        buffer_free((void *)buf, size);
+    buffer_free(dimacs_marks, (dimacs_vars_len+1)*sizeof(int32_t));
+    if (!ok)
+    {
+        sat_reset();
+        return DIMACS_UNKNOWN;
+    }
+
+    // (2) Solve:
+    debug_init();
+    stats_start();
+    result_t result = portfolio_run();
+    stats_stop();
+
+    // (3) Print the result:
+    int code;
+    switch (result)
+    {
+        case RESULT_UNKNOWN:
+            message("s SATISFIABLE");
+            dimacs_print_model();
+            code = DIMACS_SAT;
+            break;
+        case RESULT_UNSAT:
+            message("s UNSATISFIABLE");
+            code = DIMACS_UNSAT;
+            break;
+        default:
+            message("s UNKNOWN");
+            code = DIMACS_UNKNOWN;
+            break;
+    }
+    stats_print();
+
+    solver_reset();
+    sat_reset();
+    return code;
+}
+
+/*
+ * Read the whole input.  Regular files are memory-mapped; anything else
+ * (stdin, pipes) is copied into a buffer.
+ */
+static const char *dimacs_read(const char *filename, size_t *size,
+    bool *mapped)
+{
+    *mapped = false;
+    FILE *file = stdin;
+    if (filename != NULL)
+    {
+#ifndef WINDOWS
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+            fatal("unable to open file \"%s\": %s", filename,
+                strerror(errno));
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+                info.st_size > 0)
+        {
+            void *buf = mmap(NULL, (size_t)info.st_size, PROT_READ,
+                MAP_PRIVATE, fd, 0);
+            if (buf != MAP_FAILED)
+            {
+                close(fd);
+                madvise(buf, (size_t)info.st_size, MADV_SEQUENTIAL);
+                *mapped = true;
+                *size = (size_t)info.st_size;
+                return (const char *)buf;
+            }
+        }
+        close(fd);
+#endif
+        file = fopen(filename, "r");
+        if (file == NULL)
+            fatal("unable to open file \"%s\": %s", filename,
+                strerror(errno));
+    }
+
+    char *buf = (char *)buffer_alloc(DIMACS_BUFFER_SIZE);
+    size_t len = 0, n;
+    while ((n = fread(buf + len, sizeof(char), DIMACS_BUFFER_SIZE - len,
+            file)) > 0)
+        len += n;
+    if (len >= DIMACS_BUFFER_SIZE)
+        fatal("input \"%s\" is too large", (filename == NULL? "<stdin>":
+            filename));
+    if (file != stdin)
+        fclose(file);
+    *size = len;
+    return buf;
+}
+
+/*
+ * Parse the clauses and pass them to the SAT solver.
+ */
+static bool dimacs_parse(const char *filename, const char *buf, size_t size)
+{
+    const char *ptr = buf, *end = buf + size;
+    size_t lineno = 1, lineno_0 = 1;
+    size_t num_clauses = 0, max_clauses = 0;
+    size_t len = 0;
+    int32_t clause = 1;
+    bool header = false;
+
+    while (ptr < end)
+    {
+        int c = (unsigned char)*ptr;
+        if (c == '\n')
+        {
+            lineno++;
+            ptr++;
+            continue;
+        }
+        if (isspace(c))
+        {
+            ptr++;
+            continue;
+        }
+        if (c == 'c' || (c == 'p' && header))
+        {
+            // Comment (or repeated header):
+            while (ptr < end && *ptr != '\n')
+                ptr++;
+            continue;
+        }
+        if (c == 'p')
+        {
+            // Header:
+            size_t num_vars;
+            ptr = dimacs_skip_blanks(ptr + 1, end);
+            bool ok = (end - ptr >= 3 && strncmp(ptr, "cnf", 3) == 0);
+            ptr += (ok? 3: 0);
+            ok = ok && dimacs_parse_num(&ptr, end, &num_vars) &&
+                dimacs_parse_num(&ptr, end, &max_clauses);
+            if (!ok)
+            {
+                error("(%s: %zu) failed to parse DIMACS header; expected "
+                    "\"p cnf VARS CLAUSES\"", filename, lineno);
+                return false;
+            }
+            dimacs_make_vars(num_vars);
+            header = true;
+            continue;
+        }
+        if (c == '%')
+            break;      // SATLIB end-of-file marker.
+        if (c != '-' && !isdigit(c))
+        {
+            error("(%s: %zu) failed to parse DIMACS clause; unexpected "
+                "character `%c'", filename, lineno, c);
+            return false;
+        }
+
+        // Literal:
+        bool neg = (c == '-');
+        ptr += neg;
+        if (ptr >= end || !isdigit((unsigned char)*ptr))
+        {
+            error("(%s: %zu) failed to parse DIMACS clause; expected a "
+                "literal", filename, lineno);
+            return false;
+        }
+        size_t v = 0;
+        while (ptr < end && isdigit((unsigned char)*ptr))
+        {
+            v = 10 * v + (size_t)(*ptr - '0');
+            if (v > INT32_MAX / 2)
+            {
+                error("(%s: %zu) DIMACS variable out of range", filename,
+                    lineno);
+                return false;
+            }
+            ptr++;
+        }
+        if (v == 0)
+        {
+            dimacs_add_clause(dimacs_lits, len, clause, lineno_0);
+            len = 0;
+            clause++;
+            num_clauses++;
+            continue;
+        }
+        if (len == 0)
+            lineno_0 = lineno;
+        dimacs_make_vars(v);
+        literal_t lit = (literal_t)v;
+        dimacs_lits[len++] = (neg? -lit: lit);
+    }
+    if (len != 0)
+    {
+        // Tolerate a missing final `0':
+        dimacs_add_clause(dimacs_lits, len, clause, lineno_0);
+        num_clauses++;
+    }
+    if (header && num_clauses != max_clauses)
+        warning("(%s: %zu) expected %zu clauses, found %zu", filename,
+            lineno, max_clauses, num_clauses);
+    return true;
+}
+
+/*
+ * Skip spaces and tabs.
+ */
+static const char *dimacs_skip_blanks(const char *ptr, const char *end)
+{
+    while (ptr < end && (*ptr == ' ' || *ptr == '\t'))
+        ptr++;
+    return ptr;
+}
+
+/*
+ * Parse an unsigned number on the current line.
+ */
+static bool dimacs_parse_num(const char **ptr, const char *end, size_t *n)
+{
+    const char *p = dimacs_skip_blanks(*ptr, end);
+    if (p >= end || !isdigit((unsigned char)*p))
+        return false;
+    size_t m = 0;
+    while (p < end && isdigit((unsigned char)*p))
+    {
+        m = 10 * m + (size_t)(*p - '0');
+        if (m > INT32_MAX / 2)
+            return false;
+        p++;
+    }
+    *ptr = p;
+    *n = m;
+    return true;
+}
+
+/*
+ * Make sure DIMACS variables 1..num_vars exist.
+ */
+static void dimacs_make_vars(size_t num_vars)
+{
+    while (dimacs_vars_len < num_vars)
+    {
+        dimacs_vars_len++;
+        dimacs_vars[dimacs_vars_len] = sat_make_var(NULL, NULL);
+        dimacs_marks[dimacs_vars_len] = 0;
+    }
+}
+
+/*
+ * Add a clause, removing duplicate literals and tautologies.
+ */
+static void dimacs_add_clause(literal_t *lits, size_t len, int32_t clause,
+    size_t lineno)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        literal_t lit = lits[i];
+        size_t v = (size_t)(lit < 0? -lit: lit);
+        int32_t mark = (lit < 0? -clause: clause);
+        if (dimacs_marks[v] == mark)
+            continue;
+        if (dimacs_marks[v] == -mark)
+            return;             // Tautology.
+        dimacs_marks[v] = mark;
+        bvar_t b = dimacs_vars[v];
+        lits[j++] = (lit < 0? -b: b);
+    }
+    sat_add_clause(lits, j, true, "dimacs", lineno);
+}
+
+/*
+ * Print the model in DIMACS `v' lines.  Unset variables do not occur in any
+ * unsatisfied clause, so are arbitrarily printed as positive.
+ */
+static void dimacs_print_model(void)
+{
+    char line[DIMACS_LINE_LENGTH + 16];
+    size_t len = 0;
+    line[0] = '\0';
+    for (size_t v = 1; v <= dimacs_vars_len; v++)
+    {
+        bool neg = (sat_get_decision(dimacs_vars[v]) == SAT_NEG);
+        char lit[16];
+        int n = snprintf(lit, sizeof(lit), " %s%zu", (neg? "-": ""), v);
+        if (len + n > DIMACS_LINE_LENGTH)
+        {
+            message("v%s", line);
+            len = 0;
+        }
+        memcpy(line + len, lit, n+1);
+        len += n;
+    }
+    message("v%s 0", line);
+}
@@ -0,0 +1,45 @@
+/*
+ * dimacs.h
+ * Copyright (C) 2018 National University of Singapore
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __DIMACS_H
+#define __DIMACS_H
+
+#include <stdbool.h>
+
+/*
+ * DIMACS exit codes.
+ */
+#define DIMACS_UNKNOWN          0
+#define DIMACS_SAT              10
+#define DIMACS_UNSAT            20
+
+/*
+ * Test if the given file starts with a DIMACS `p cnf' header (possibly
+ * preceded by comment lines).
+ */
+extern bool dimacs_detect(const char *filename);
+
+/*
+ * Solve a DIMACS CNF problem read from the given file (or stdin if
+ * `filename' is NULL).  The clauses are passed directly to the SAT solver,
+ * bypassing the term/expression pipeline.  The result is printed in the
+ * standard `s SATISFIABLE'/`v ...' format, and the DIMACS exit code is
+ * returned.
+ */
+extern int dimacs_solve(const char *filename);
+
+#endif      /* __DIMACS_H */
@@ -18,6 +18,33 @@
 
 #include "solver.h"
 
+/*
+ * Per-variable event watch lists.
+ */
+struct eventinfo_s
+{
+    proplist_t lb;          // EVENT_LB watchers.
+    proplist_t ub;          // EVENT_UB watchers.
+    proplist_t fix;         // EVENT_FIX watchers.
+    word_t pad;             // Keep later extras 16-byte aligned.
+};
+typedef struct eventinfo_s *eventinfo_t;
+
+/*
+ * var_t interface.
+ */
+static size_t event_offset;
+
+/*
+ * Initialize variable events.
+ */
+extern void solver_init_event(void)
+{
+    struct eventinfo_s template = {NULL, NULL, NULL, 0};
+    event_offset = alloc_extra(WORD_SIZEOF(struct eventinfo_s),
+        (word_t *)&template);
+}
+
 /*
  * Set event for a constraint.
  */
@@ -106,3 +133,33 @@ extern void solver_event_user(proplist_t ps)
     }
 }
 
+
+/*
+ * Delay on a variable event.
+ */
+extern void solver_delay_var(prop_t prop, var_t x, event_t e)
+{
+    if ((e & ~EVENT_VAR) != 0)
+        panic("invalid variable event (0x%x)", e);
+    eventinfo_t info = (eventinfo_t)extra(x, event_offset);
+    if ((e & EVENT_LB) != 0)
+        info->lb = solver_delay_user(prop, info->lb);
+    if ((e & EVENT_UB) != 0)
+        info->ub = solver_delay_user(prop, info->ub);
+    if ((e & EVENT_FIX) != 0)
+        info->fix = solver_delay_user(prop, info->fix);
+}
+
+/*
+ * Signal a variable event.
+ */
+extern void solver_event_var(var_t x, event_t e)
+{
+    eventinfo_t info = (eventinfo_t)extra(x, event_offset);
+    if ((e & EVENT_LB) != 0)
+        solver_event_user(info->lb);
+    if ((e & EVENT_UB) != 0)
+        solver_event_user(info->ub);
+    if ((e & EVENT_FIX) != 0)
+        solver_event_user(info->fix);
+}
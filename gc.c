@@ -18,7 +18,8 @@
 
 /*
  * This is a very simple conservative GC implementation for single-threaded
- * x86_64/AMD64.
+ * x86_64/AMD64.  The mark phase can optionally be shared with helper threads
+ * (see GC_mark_threads()); the mutator itself must remain single-threaded.
  */
 
 #include <assert.h>
@@ -31,6 +32,10 @@
 
 #include "gc.h"
 
+#ifdef PROPPROF
+#include <x86intrin.h>
+#endif
+
 /*
  * GC tuning
  */
@@ -43,6 +48,12 @@
 #define GC_MAX_ROOT_SIZE        0x40000000      // 1 GB
 #define GC_MAX_MARK_PUSH        1024
 #define GC_PAGESIZE             4096
+#define GC_MARK_DEQUE_SIZE      0x10000000      // 256 MB (per thread)
+#define GC_MARK_CHUNK           4096            // Max pointers per work item
+#define GC_ARENA_SIZE           0x40000000      // 1 GB
+#define GC_NURSERY_SIZE         0x800000        // Min. nursery (8 MB)
+#define GC_REMEMBER_SIZE        0x10000000      // 256 MB
+#define GC_PAGE_MAP_SIZE        (GC_NUM_REGIONS*GC_REGION_SIZE/GC_PAGESIZE)
 
 /*
  * A GC free-list node.
@@ -65,6 +76,21 @@ struct gc_markstack_s
 typedef struct gc_markstack_s *gc_markstack_t;
 typedef uint64_t gc_markunit_t;
 
+/*
+ * Parallel mark work-stealing deque.  The owner pushes and pops at 'top',
+ * other threads steal from 'bottom'.  Both ends are protected by 'lock'.
+ */
+struct gc_markdeque_s
+{
+    gc_markstack_t items;                       // Work items.
+    size_t bottom;                              // Steal end.
+    size_t top;                                 // Owner end.
+    size_t used;                                // Used size (this thread).
+    size_t generation;                          // Last collection joined.
+    bool lock;                                  // Spin lock.
+} __attribute__((__aligned__(64)));
+typedef struct gc_markdeque_s *gc_markdeque_t;
+
 /*
  * Root node.
  */
@@ -75,6 +101,7 @@ struct gc_root_s
     void **ptrptr;                              // Start pointer.
     size_t *sizeptr;                            // Size pointer.
     size_t elemsize;                            // Element size.
+    uint64_t layout;                            // Pointer words (0 = all).
     struct gc_root_s *next;                     // Next pointer.
 };
 typedef struct gc_root_s *gc_root_t;
@@ -88,15 +115,46 @@ static bool gc_inited = false;                  // Is GC initialised?
 static bool gc_enabled = true;                  // Is collection enabled?
 static void *gc_stackbottom;                    // Stack bottom.
 struct gc_region_s __gc_regions[GC_NUM_REGIONS] = {{0}};
+struct gc_arena_s __gc_arena = {NULL, NULL, NULL, false};
 static void *gc_markstack;                      // Mark-stack.
 static gc_root_t gc_roots = NULL;               // All GC roots.
 static gc_error_func_t gc_error_func = NULL;    // Memory error callback.
 
+// Parallel marking:
+static size_t gc_mark_nthreads = 1;             // Requested mark threads.
+
 // Timing and stats related:
 static ssize_t gc_total_size = 0;               // Total size.
 static ssize_t gc_alloc_size = 0;               // Total allocation (since GC).
 static ssize_t gc_trigger_size = GC_MIN_TRIGGER;// GC trigger size.
 static ssize_t gc_used_size  = 0;               // Total used memory.
+static bool gc_sweep_returning = false;         // Return memory on sweep?
+static struct gc_histogram_s gc_pause_hist;     // Collection pause times.
+static struct gc_histogram_s gc_sweep_hist;     // Lazy sweep times.
+
+// Generational:
+static bool gc_generational = false;            // Minor collections on?
+static bool gc_remember_overflowed = false;     // Remembered set overflow?
+static ssize_t gc_major_size = 0;               // Major collection size.
+static void **gc_remember_start = NULL;         // Remembered set.
+static void **gc_remember_ptr = NULL;           // Remembered set (next).
+static void **gc_remember_end = NULL;           // Remembered set (end).
+static volatile uint8_t *gc_page_map = NULL;    // Page write barrier state.
+
+/*
+ * Page write barrier states (see gc_page_map).
+ */
+#define GC_PAGE_UNPROTECTED     0
+#define GC_PAGE_PROTECTED       1
+#define GC_PAGE_DIRTY           2
+
+/*
+ * Index of the GC page containing 'ptr' (in gc_page_map).
+ */
+static inline size_t gc_page_index(const void *ptr)
+{
+    return ((const char *)ptr - GC_MEMORY) / GC_PAGESIZE;
+}
 
 /*
  * GC debugging.
@@ -122,9 +180,22 @@ static void gc_debug(const char *format, ...)
  */
 static void __attribute__((noinline)) *gc_stacktop(void);
 static void gc_add_root(gc_root_t root);
-static void gc_mark_init(void);
+static bool gc_collect_generation(bool minor);
+static void gc_mark_init(bool minor);
+static bool gc_mark_remembered(void);
+static void gc_nursery_protect(bool protect);
 static void gc_mark(gc_root_t roots);
+static void gc_mark_parallel(gc_root_t roots);
 static void gc_sweep(void);
+static void gc_sweep_region(gc_region_t region, bool returning);
+#ifdef PROPPROF
+static void gc_histogram_record(struct gc_histogram_s *hist, uint64_t start);
+#define GC_PROFILE_BEGIN()      uint64_t profile_start = __rdtsc()
+#define GC_PROFILE_END(hist)    gc_histogram_record((hist), profile_start)
+#else
+#define GC_PROFILE_BEGIN()
+#define GC_PROFILE_END(hist)
+#endif      /* PROPPROF */
 static inline bool gc_is_marked_index(uint8_t *markptr_0, uint32_t idx);
 
 #define gc_read_prefetch(ptr)   __builtin_prefetch((ptr), 0, 1)
@@ -191,6 +262,8 @@ static void *gc_get_stackbottom(void)
  * Linux/MACOSX.
  */
 
+#include <pthread.h>
+#include <signal.h>
 #include <sys/mman.h>
 #include <sys/syscall.h>
 
@@ -244,7 +317,6 @@ static void *gc_get_stackbottom(void)
     return stackbottom;
 }
 #else       /* __APPLE__ */
-#include <pthread.h>
 int pthread_getattr_np(pthread_t thread, pthread_attr_t *attr);
 static void *gc_get_stackbottom(void)
 {
@@ -320,6 +392,7 @@ extern bool GC_init(void)
         region->markstartptr = startptr;
         region->markendptr   = startptr;
         region->markptr      = NULL;
+        region->sweep        = false;
         region->startidx     = gc_objidx(startptr);
     }
 
@@ -372,6 +445,7 @@ extern bool GC_root(void *ptr, size_t size)
     root->ptrptr = &root->ptr;
     root->sizeptr = &root->size;
     root->elemsize = 1;
+    root->layout = 0;
     gc_add_root(root);
     return true;
 }
@@ -381,6 +455,22 @@ extern bool GC_root(void *ptr, size_t size)
  */
 extern bool GC_dynamic_root(void **ptrptr, size_t *sizeptr, size_t elemsize)
 {
+    return GC_typed_root(ptrptr, sizeptr, elemsize, 0);
+}
+
+/*
+ * GC typed dynamic root registration.
+ */
+extern bool GC_typed_root(void **ptrptr, size_t *sizeptr, size_t elemsize,
+    uint64_t layout)
+{
+    size_t elemlen = elemsize / sizeof(void *);
+    if (layout != 0 && (elemsize % sizeof(void *) != 0 || elemlen > 64 ||
+            (elemlen < 64 && (layout >> elemlen) != 0)))
+    {
+        errno = EINVAL;
+        return false;
+    }
     gc_root_t root = (gc_root_t)malloc(sizeof(struct gc_root_s));
     if (root == NULL)
         return false;
@@ -389,6 +479,7 @@ extern bool GC_dynamic_root(void **ptrptr, size_t *sizeptr, size_t elemsize)
     root->ptrptr = ptrptr;
     root->sizeptr = sizeptr;
     root->elemsize = elemsize;
+    root->layout = layout;
     gc_add_root(root);
     return true;
 }
@@ -439,20 +530,37 @@ static inline void gc_maybe_collect(uint32_t size)
     {
         if (!gc_enabled)
             return;
-        gc_collect();
+        bool minor = (gc_generational && !gc_remember_overflowed &&
+            gc_used_size < gc_major_size);
+        minor = gc_collect_generation(minor);
         size_t gc_scan_size = 0;
         size_t stacksize = gc_stackbottom - gc_stacktop();
         gc_scan_size += 2*stacksize;
         gc_root_t root = gc_roots;
         while (root != NULL)
         {
-            gc_scan_size += (*root->sizeptr)*root->elemsize;
+            gc_scan_size += (*root->sizeptr)*(root->layout == 0?
+                root->elemsize:
+                __builtin_popcountll(root->layout)*sizeof(void *));
             root = root->next;
         }
+        gc_scan_size += __gc_arena.freeptr - __gc_arena.startptr;
+        size_t gc_root_size = gc_scan_size;
         gc_scan_size += 2*gc_used_size;
-        gc_trigger_size = (size_t)(gc_scan_size / GC_SPACE_FACTOR);
-        gc_trigger_size = (gc_trigger_size < GC_MIN_TRIGGER? GC_MIN_TRIGGER:
-            gc_trigger_size);
+        if (!minor)
+        {
+            gc_trigger_size = (size_t)(gc_scan_size / GC_SPACE_FACTOR);
+            gc_trigger_size = (gc_trigger_size < GC_MIN_TRIGGER?
+                GC_MIN_TRIGGER: gc_trigger_size);
+            gc_major_size = gc_used_size + gc_trigger_size;
+        }
+        if (gc_generational)
+        {
+            // The nursery is big enough to amortize the root scan:
+            gc_trigger_size = (size_t)(gc_root_size / GC_SPACE_FACTOR);
+            gc_trigger_size = (gc_trigger_size < GC_NURSERY_SIZE?
+                GC_NURSERY_SIZE: gc_trigger_size);
+        }
         gc_alloc_size = size;
     }
 }
@@ -479,9 +587,16 @@ nonempty_freelist:
         return ptr;
     }
 
-    // (2) Next, attempt to allocated from marked memory.
+    // (2) Next, attempt to allocated from marked memory.  The region is
+    //     lazily swept first (if required).
     if (region->markstartptr < region->markendptr)
     {
+        if (region->sweep)
+        {
+            GC_PROFILE_BEGIN();
+            gc_sweep_region(region, gc_sweep_returning);
+            GC_PROFILE_END(&gc_sweep_hist);
+        }
         ptr = region->markstartptr;
         uint32_t ptridx = (uint32_t)(gc_objidx(ptr) - region->startidx);
         uint8_t *markptr = region->markptr;
@@ -519,7 +634,16 @@ nonempty_freelist:
         size_t protectlen = GC_PROTECT_LEN*GC_PAGESIZE;
         protectlen = (protectlen < region->size? region->size:
             protectlen);
-        if (gc_protect_memory(protectptr, protectlen) != 0)
+        void *commitptr = protectptr;
+        if (protectptr != region->startptr)
+        {
+            // The page containing 'protectptr' is already accessible, and
+            // may be write protected by the nursery, so it is skipped.
+            uintptr_t offset = (uintptr_t)protectptr % GC_PAGESIZE;
+            commitptr += (offset == 0? 0: GC_PAGESIZE - offset);
+        }
+        if (gc_protect_memory(commitptr,
+                protectptr + protectlen - commitptr) != 0)
         {
             gc_debug("protect failed");
             gc_handle_error(false, 0);
@@ -531,6 +655,35 @@ nonempty_freelist:
     return ptr;
 }
 
+/*
+ * GC arena begin.
+ */
+extern bool GC_arena_begin(void)
+{
+    struct gc_arena_s *arena = &__gc_arena;
+    if (arena->startptr == NULL)
+    {
+        char *ptr = (char *)gc_get_mark_memory(GC_ARENA_SIZE);
+        if (ptr == NULL)
+            return false;
+        arena->startptr = ptr;
+        arena->freeptr  = ptr;
+        arena->endptr   = ptr + GC_ARENA_SIZE;
+    }
+    arena->on = true;
+    return true;
+}
+
+/*
+ * GC arena end.
+ */
+extern void GC_arena_end(void)
+{
+    struct gc_arena_s *arena = &__gc_arena;
+    arena->on = false;
+    arena->freeptr = arena->startptr;
+}
+
 /*
  * GC memory reallocation.
  */
@@ -576,10 +729,28 @@ extern void GC_collect(void)
     // Is collection enabled?
     if (!gc_enabled)
         return;
+    gc_collect_generation(false);
+}
+
+/*
+ * GC major/minor collection.  Returns `true' if the collection was minor.
+ *
+ * A minor collection keeps the mark bits from the previous collection, so
+ * that marked (old) objects are neither re-marked nor re-scanned, and only
+ * the unmarked (young) objects reachable from the roots and the remembered
+ * set are marked, i.e. promoted.
+ */
+static bool gc_collect_generation(bool minor)
+{
+    GC_PROFILE_BEGIN();
 
     // Initialize marking
-    gc_debug("collect [stage=init_marks]");
-    gc_mark_init();
+    gc_debug("collect [stage=init_marks, minor=%d]", minor);
+    if (minor && !gc_mark_remembered())
+        minor = false;
+    gc_mark_init(minor);
+    if (!minor)
+        gc_used_size = 0;
 
     gc_debug("collect [stage=mark]");
     struct gc_root_s root_0;
@@ -589,17 +760,61 @@ extern void GC_collect(void)
     root->ptrptr = &root->ptr;
     root->sizeptr = &root->size;
     root->elemsize = 1;
+    root->layout = 0;
     root->next = gc_roots;
     gc_root_t roots = root;
 
-    gc_mark(roots);
+    // The used part of the arena is also a root:
+    struct gc_root_s root_1;
+    if (__gc_arena.freeptr > __gc_arena.startptr)
+    {
+        root = &root_1;
+        root->ptr = __gc_arena.startptr;
+        root->size = __gc_arena.freeptr - __gc_arena.startptr;
+        root->ptrptr = &root->ptr;
+        root->sizeptr = &root->size;
+        root->elemsize = 1;
+        root->layout = 0;
+        root->next = roots;
+        roots = root;
+    }
+
+    // The remembered set is also a root (minor only):
+    struct gc_root_s root_2;
+    if (minor && gc_remember_ptr > gc_remember_start)
+    {
+        root = &root_2;
+        root->ptr = gc_remember_start;
+        root->size = (void *)gc_remember_ptr - root->ptr;
+        root->ptrptr = &root->ptr;
+        root->sizeptr = &root->size;
+        root->elemsize = 1;
+        root->layout = 0;
+        root->next = roots;
+        roots = root;
+    }
+
+    if (gc_mark_nthreads > 1)
+        gc_mark_parallel(roots);
+    else
+        gc_mark(roots);
     gc_sweep();
+    if (gc_generational)
+    {
+        // Start a new nursery: old objects are write protected so that the
+        // pages they are modified on can be found by the next collection.
+        gc_remember_ptr = gc_remember_start;
+        gc_remember_overflowed = false;
+        gc_nursery_protect(true);
+    }
+    GC_PROFILE_END(&gc_pause_hist);
+    return minor;
 }
 
 /*
  * Initialize marking.
  */
-static void gc_mark_init(void)
+static void gc_mark_init(bool minor)
 {
     gc_total_size = 0;
 
@@ -620,7 +835,7 @@ static void gc_mark_init(void)
                 gc_handle_error(true, 0);
             region->markptr = (uint8_t *)markptr;
         }
-        else
+        else if (!minor)
         {
             size_t marksize = (regionsize + 7) / 8;
             gc_zero_memory(region->markptr, marksize);
@@ -628,6 +843,58 @@ static void gc_mark_init(void)
     }
 }
 
+/*
+ * Build the remembered set from the dirty pages, i.e. the protected pages
+ * written to since the last collection.  Old objects on these pages are
+ * unmarked and added to the remembered set.  The remembered set is scanned
+ * as a root, so these objects will be re-marked and re-scanned for pointers
+ * to young objects.  Returns `false' if the remembered set overflowed, in
+ * which case a major collection is required.
+ */
+static bool gc_mark_remembered(void)
+{
+    if (gc_remember_overflowed)
+        return false;
+    for (size_t i = 0; i < GC_NUM_REGIONS; i++)
+    {
+        gc_region_t region = __gc_regions + i;
+        if (region->freeptr == region->startptr)
+            continue;
+        gc_markunit_t *markptr = (gc_markunit_t *)region->markptr;
+        uint32_t size = region->size;
+        size_t page = gc_page_index(region->startptr);
+        size_t endpage = gc_page_index(region->freeptr - 1);
+        for (; page <= endpage; page++)
+        {
+            if (gc_page_map[page] != GC_PAGE_DIRTY)
+                continue;
+            void *startptr = GC_MEMORY + page*GC_PAGESIZE,
+                 *endptr = startptr + GC_PAGESIZE;
+            startptr = (startptr < region->startptr? region->startptr:
+                startptr);
+            endptr = (endptr > region->freeptr? region->freeptr: endptr);
+            uint32_t ptridx =
+                (uint32_t)(gc_objidx(startptr) - region->startidx);
+            uint32_t endidx =
+                (uint32_t)(gc_objidx(endptr-1) - region->startidx);
+            for (; ptridx <= endidx; ptridx++)
+            {
+                uint32_t unitidx = (ptridx / (sizeof(gc_markunit_t)*8));
+                uint32_t bitidx  = (ptridx % (sizeof(gc_markunit_t)*8));
+                gc_markunit_t markmask = (gc_markunit_t)0x01 << bitidx;
+                if ((markptr[unitidx] & markmask) == 0)
+                    continue;
+                if (gc_remember_ptr >= gc_remember_end)
+                    return false;
+                markptr[unitidx] &= ~markmask;
+                gc_used_size -= size;
+                *gc_remember_ptr++ = region->startptr + (size_t)ptridx*size;
+            }
+        }
+    }
+    return true;
+}
+
 /*
  * Mark the given index.
  */
@@ -660,6 +927,21 @@ static inline bool gc_is_marked_index(uint8_t *markptr_0, uint32_t idx)
     return ((markunit & markmask) != 0);
 }
 
+/*
+ * Remove the next run of consecutive pointer words [*start..*end) from a
+ * typed root layout.
+ */
+static inline void gc_layout_next(uint64_t *layout, size_t *start,
+    size_t *end)
+{
+    size_t i = __builtin_ctzll(*layout);
+    uint64_t run = ~(*layout >> i);
+    size_t j = (run == 0? 64: i + __builtin_ctzll(run));
+    *layout = (j == 64? 0: *layout & (~(uint64_t)0 << j));
+    *start = i;
+    *end = j;
+}
+
 /*
  * GC marking.
  */
@@ -671,15 +953,44 @@ static void gc_mark(gc_root_t roots)
     stack->startptr = NULL;
     stack->endptr   = NULL;
 
-    gc_used_size = 0;
- 
+    // The typed root being scanned (if any):
+    void **elemptr = NULL, **elemendptr = NULL;
+    size_t elemlen = 0;
+    uint64_t layout = 0, elemlayout = 0;
+
     while (true)
     {
         void **ptrptr = stack->startptr;
         void **endptr = stack->endptr;
         if (ptrptr == NULL)
         {
+            // Attempt to find some work from the typed root; each run of
+            // pointer words in each element is scanned separately.
+            if (elemlayout != 0)
+            {
+                size_t start, end;
+                gc_layout_next(&elemlayout, &start, &end);
+                ptrptr = elemptr + start;
+                endptr = elemptr + end;
+                if (elemlayout == 0)
+                {
+                    elemptr += elemlen;
+                    elemlayout = (elemptr < elemendptr? layout: 0);
+                }
+                goto gc_mark_loop_inner;
+            }
+
             // Attempt to find some work from the root list.
+            if (roots != NULL && roots->layout != 0)
+            {
+                elemptr = (void **)*roots->ptrptr;
+                elemlen = roots->elemsize / sizeof(void *);
+                elemendptr = elemptr + (*roots->sizeptr)*elemlen;
+                layout = roots->layout;
+                elemlayout = (elemptr < elemendptr? layout: 0);
+                roots = roots->next;
+                continue;
+            }
             if (roots != NULL)
             {
                 ptrptr = (void **)*roots->ptrptr;
@@ -754,70 +1065,696 @@ gc_mark_loop_inner:
     }
 }
 
+/*
+ * Parallel marking.
+ *
+ * The main thread and (gc_mark_nthreads-1) helper threads each own a
+ * work-stealing deque of [startptr..endptr) ranges.  Mark bits are set with
+ * an atomic OR so that each object is claimed (and scanned) by exactly one
+ * thread.  Large ranges (e.g. the dynamic roots) are split into chunks of
+ * GC_MARK_CHUNK pointers so the work can be shared.  Marking terminates
+ * once every thread is idle, since only non-idle threads can create work.
+ */
+#ifndef __MINGW32__
+
+static struct gc_markdeque_s gc_mark_deques[GC_MARK_THREADS_MAX];
+static size_t gc_mark_helpers = 0;              // Running helper threads.
+static size_t gc_mark_workers = 0;              // Threads this collection.
+static size_t gc_mark_idle = 0;                 // Idle threads.
+static size_t gc_mark_generation = 0;           // Collection counter.
+static size_t gc_mark_finished = 0;             // Finished helpers.
+static pthread_mutex_t gc_mark_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gc_mark_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t gc_mark_finish = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Deque spin lock.
+ */
+static inline void gc_mark_lock(gc_markdeque_t deque)
+{
+    while (__atomic_test_and_set(&deque->lock, __ATOMIC_ACQUIRE))
+    {
+        while (__atomic_load_n(&deque->lock, __ATOMIC_RELAXED))
+            __builtin_ia32_pause();
+    }
+}
+static inline void gc_mark_unlock(gc_markdeque_t deque)
+{
+    __atomic_clear(&deque->lock, __ATOMIC_RELEASE);
+}
+
+/*
+ * Deque operations.
+ */
+static inline void gc_mark_push(gc_markdeque_t deque, void **startptr,
+    void **endptr)
+{
+    gc_mark_lock(deque);
+    size_t top = deque->top;
+    if (top >= GC_MARK_DEQUE_SIZE / sizeof(struct gc_markstack_s))
+        gc_handle_error(true, ENOMEM);
+    deque->items[top].startptr = startptr;
+    deque->items[top].endptr   = endptr;
+    __atomic_store_n(&deque->top, top+1, __ATOMIC_RELEASE);
+    gc_mark_unlock(deque);
+}
+static inline bool gc_mark_pop(gc_markdeque_t deque, void ***startptr,
+    void ***endptr)
+{
+    gc_mark_lock(deque);
+    size_t top = deque->top;
+    if (top == deque->bottom)
+    {
+        gc_mark_unlock(deque);
+        return false;
+    }
+    top--;
+    *startptr = deque->items[top].startptr;
+    *endptr   = deque->items[top].endptr;
+    if (top == deque->bottom)
+    {
+        __atomic_store_n(&deque->bottom, 0, __ATOMIC_RELAXED);
+        top = 0;
+    }
+    __atomic_store_n(&deque->top, top, __ATOMIC_RELEASE);
+    gc_mark_unlock(deque);
+    return true;
+}
+static inline bool gc_mark_is_empty(gc_markdeque_t deque)
+{
+    return (__atomic_load_n(&deque->top, __ATOMIC_ACQUIRE) ==
+            __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE));
+}
+static bool gc_mark_steal(size_t id, void ***startptr, void ***endptr)
+{
+    size_t n = gc_mark_workers;
+    for (size_t i = 1; i < n; i++)
+    {
+        gc_markdeque_t victim = gc_mark_deques + (id + i) % n;
+        if (gc_mark_is_empty(victim))
+            continue;
+        gc_mark_lock(victim);
+        size_t bottom = victim->bottom;
+        if (bottom == victim->top)
+        {
+            gc_mark_unlock(victim);
+            continue;
+        }
+        // Steal the oldest item; this tends to be the largest.
+        *startptr = victim->items[bottom].startptr;
+        *endptr   = victim->items[bottom].endptr;
+        bottom++;
+        if (bottom == victim->top)
+        {
+            bottom = 0;
+            __atomic_store_n(&victim->top, 0, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&victim->bottom, bottom, __ATOMIC_RELEASE);
+        gc_mark_unlock(victim);
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Mark the given index (atomic version).
+ */
+static inline bool gc_mark_index_atomic(uint8_t *markptr_0, uint32_t idx)
+{
+    gc_markunit_t *markptr = (gc_markunit_t *)markptr_0;
+    uint32_t unitidx = (idx / (sizeof(gc_markunit_t)*8));
+    uint32_t bitidx  = (idx % (sizeof(gc_markunit_t)*8));
+    gc_markunit_t markmask = (gc_markunit_t)0x01 << bitidx;
+    if (__atomic_load_n(markptr + unitidx, __ATOMIC_RELAXED) & markmask)
+        return false;
+    gc_markunit_t markunit = __atomic_fetch_or(markptr + unitidx, markmask,
+        __ATOMIC_RELAXED);
+    return ((markunit & markmask) == 0);
+}
+
+/*
+ * Scan a range, pushing newly marked objects onto the deque.
+ */
+static void gc_mark_range(gc_markdeque_t deque, void **ptrptr,
+    void **endptr)
+{
+    if (endptr - ptrptr > GC_MARK_CHUNK)
+    {
+        gc_mark_push(deque, ptrptr + GC_MARK_CHUNK, endptr);
+        endptr = ptrptr + GC_MARK_CHUNK;
+    }
+    size_t used = 0;
+    while (ptrptr < endptr)
+    {
+        void *ptr = *ptrptr;
+        ptrptr++;
+        if (!gc_isptr(ptr))
+            continue;
+        gc_read_prefetch(ptrptr);
+        size_t idx = gc_index(ptr);
+        gc_region_t region = __gc_regions + idx;
+        if (ptr >= region->freeptr || ptr < region->startptr)
+            continue;
+        uint32_t size = region->size;
+        uint32_t ptridx = (uint32_t)(gc_objidx(ptr) - region->startidx);
+        if (!gc_mark_index_atomic(region->markptr, ptridx))
+            continue;
+        used += size;
+        ptr = region->startptr + (size_t)ptridx*(size_t)size;
+        gc_read_prefetch(ptr);
+        gc_mark_push(deque, (void **)ptr, (void **)(ptr + size));
+    }
+    deque->used += used;
+}
+
+/*
+ * Scan the pointer words of a typed root.
+ */
+static void gc_mark_typed(gc_markdeque_t deque, gc_root_t root)
+{
+    size_t elemlen = root->elemsize / sizeof(void *);
+    void **elemptr = (void **)*root->ptrptr;
+    void **elemendptr = elemptr + (*root->sizeptr)*elemlen;
+    for (; elemptr < elemendptr; elemptr += elemlen)
+    {
+        uint64_t layout = root->layout;
+        while (layout != 0)
+        {
+            size_t start, end;
+            gc_layout_next(&layout, &start, &end);
+            gc_mark_range(deque, elemptr + start, elemptr + end);
+        }
+    }
+}
+
+/*
+ * Mark worker (run by all threads).
+ */
+static void gc_mark_worker(size_t id)
+{
+    gc_markdeque_t deque = gc_mark_deques + id;
+    size_t n = gc_mark_workers;
+    void **startptr, **endptr;
+    while (true)
+    {
+        if (gc_mark_pop(deque, &startptr, &endptr) ||
+                gc_mark_steal(id, &startptr, &endptr))
+        {
+            gc_mark_range(deque, startptr, endptr);
+            continue;
+        }
+
+        // Out of work; wait until either some work appears, or all threads
+        // are idle.
+        __atomic_add_fetch(&gc_mark_idle, 1, __ATOMIC_ACQ_REL);
+        while (true)
+        {
+            if (__atomic_load_n(&gc_mark_idle, __ATOMIC_ACQUIRE) == n)
+                return;
+            bool found = false;
+            for (size_t i = 0; !found && i < n; i++)
+                found = !gc_mark_is_empty(gc_mark_deques + i);
+            if (found)
+                break;
+            __builtin_ia32_pause();
+        }
+        __atomic_sub_fetch(&gc_mark_idle, 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+/*
+ * Mark helper thread.
+ */
+static void *gc_mark_helper(void *arg)
+{
+    size_t id = (size_t)arg;
+    gc_markdeque_t deque = gc_mark_deques + id;
+    while (true)
+    {
+        pthread_mutex_lock(&gc_mark_mutex);
+        while (gc_mark_generation == deque->generation)
+            pthread_cond_wait(&gc_mark_start, &gc_mark_mutex);
+        deque->generation = gc_mark_generation;
+        pthread_mutex_unlock(&gc_mark_mutex);
+
+        gc_mark_worker(id);
+
+        pthread_mutex_lock(&gc_mark_mutex);
+        gc_mark_finished++;
+        if (gc_mark_finished == gc_mark_workers-1)
+            pthread_cond_signal(&gc_mark_finish);
+        pthread_mutex_unlock(&gc_mark_mutex);
+    }
+    return NULL;
+}
+
+/*
+ * Helper threads do not survive fork(); the child must start its own.
+ */
+static void gc_mark_atfork_child(void)
+{
+    gc_mark_helpers = 0;
+    pthread_mutex_init(&gc_mark_mutex, NULL);
+    pthread_cond_init(&gc_mark_start, NULL);
+    pthread_cond_init(&gc_mark_finish, NULL);
+}
+
+/*
+ * Start helper threads (as required).
+ */
+static void gc_mark_start_helpers(void)
+{
+    static bool atfork = false;
+    if (!atfork)
+    {
+        pthread_atfork(NULL, NULL, gc_mark_atfork_child);
+        atfork = true;
+    }
+    for (size_t i = 0; i < gc_mark_nthreads; i++)
+    {
+        if (gc_mark_deques[i].items != NULL)
+            continue;
+        void *items = gc_get_mark_memory(GC_MARK_DEQUE_SIZE);
+        if (items == NULL)
+            gc_handle_error(true, 0);
+        gc_mark_deques[i].items = (gc_markstack_t)items;
+    }
+    while (gc_mark_helpers+1 < gc_mark_nthreads)
+    {
+        // The helper joins the next collection, even if it is scheduled
+        // after the collection has started (or inherited a counter across
+        // fork()).
+        gc_mark_deques[gc_mark_helpers+1].generation = gc_mark_generation;
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        int err = pthread_create(&thread, &attr, gc_mark_helper,
+            (void *)(gc_mark_helpers+1));
+        pthread_attr_destroy(&attr);
+        if (err != 0)
+        {
+            gc_debug("failed to create mark thread (%s)", strerror(err));
+            break;
+        }
+        gc_mark_helpers++;
+    }
+}
+
+/*
+ * GC parallel marking.
+ */
+static void gc_mark_parallel(gc_root_t roots)
+{
+    gc_mark_start_helpers();
+    if (gc_mark_helpers == 0)
+    {
+        gc_mark(roots);
+        return;
+    }
+
+    // Seed the main thread's deque with the untyped roots.
+    gc_markdeque_t deque = gc_mark_deques;
+    gc_root_t typed = roots;
+    for (; roots != NULL; roots = roots->next)
+    {
+        if (roots->layout != 0)
+            continue;
+        void **ptrptr = (void **)*roots->ptrptr;
+        size_t size = (*roots->sizeptr)*roots->elemsize;
+        void **endptr = ptrptr + size/sizeof(void *);
+        if (ptrptr < endptr)
+            gc_mark_push(deque, ptrptr, endptr);
+    }
+
+    pthread_mutex_lock(&gc_mark_mutex);
+    gc_mark_workers = gc_mark_helpers+1;
+    gc_mark_idle = 0;
+    gc_mark_finished = 0;
+    for (size_t i = 0; i < gc_mark_workers; i++)
+        gc_mark_deques[i].used = 0;
+    gc_mark_generation++;
+    pthread_cond_broadcast(&gc_mark_start);
+    pthread_mutex_unlock(&gc_mark_mutex);
+
+    // The typed roots are scanned by the main thread, while the helpers
+    // share the work it generates:
+    for (; typed != NULL; typed = typed->next)
+    {
+        if (typed->layout != 0)
+            gc_mark_typed(deque, typed);
+    }
+    gc_mark_worker(0);
+
+    pthread_mutex_lock(&gc_mark_mutex);
+    while (gc_mark_finished < gc_mark_workers-1)
+        pthread_cond_wait(&gc_mark_finish, &gc_mark_mutex);
+    pthread_mutex_unlock(&gc_mark_mutex);
+
+    for (size_t i = 0; i < gc_mark_workers; i++)
+        gc_used_size += gc_mark_deques[i].used;
+    gc_debug("collect [stage=sweep]");
+}
+
+#else       /* __MINGW32__ */
+
+static void gc_mark_parallel(gc_root_t roots)
+{
+    gc_mark(roots);
+}
+
+#endif      /* __MINGW32__ */
+
+#ifndef __MINGW32__
+
+static struct sigaction gc_nursery_action;      // Previous SIGSEGV action.
+
+/*
+ * GC write barrier.
+ *
+ * While minor collections are enabled, the pages holding old (marked)
+ * objects are write protected after each collection.  The first write to a
+ * protected page faults, and the handler only unprotects the page and flags
+ * it as dirty in gc_page_map; the dirty pages are processed by the next
+ * collection (see gc_mark_remembered()).
+ */
+static void gc_nursery_handler(int sig, siginfo_t *info, void *context)
+{
+    void *ptr = info->si_addr;
+    if (gc_isptr(ptr))
+    {
+        size_t page = gc_page_index(ptr);
+        switch (gc_page_map[page])
+        {
+            case GC_PAGE_PROTECTED:
+                if (mprotect(GC_MEMORY + page*GC_PAGESIZE, GC_PAGESIZE,
+                        PROT_READ | PROT_WRITE) != 0)
+                    break;
+                gc_page_map[page] = GC_PAGE_DIRTY;
+                return;
+            case GC_PAGE_DIRTY:
+                // Another thread unprotected the page first.
+                return;
+            default:
+                break;
+        }
+    }
+
+    // Not a write barrier fault; the faulting instruction will fault again
+    // with the previous action.
+    sigaction(SIGSEGV, &gc_nursery_action, NULL);
+}
+
+/*
+ * Test if any object overlapping the given page is marked.
+ */
+static bool gc_is_marked_page(gc_region_t region, size_t page)
+{
+    void *startptr = GC_MEMORY + page*GC_PAGESIZE,
+         *endptr = startptr + GC_PAGESIZE;
+    startptr = (startptr < region->startptr? region->startptr: startptr);
+    endptr = (endptr > region->freeptr? region->freeptr: endptr);
+    gc_markunit_t *markptr = (gc_markunit_t *)region->markptr;
+    uint32_t ptridx = (uint32_t)(gc_objidx(startptr) - region->startidx);
+    uint32_t endidx = (uint32_t)(gc_objidx(endptr-1) - region->startidx);
+    const uint32_t unitbits = sizeof(gc_markunit_t)*8;
+    while (ptridx <= endidx)
+    {
+        uint32_t bitidx = ptridx % unitbits;
+        uint32_t n = unitbits - bitidx;
+        gc_markunit_t markunit = markptr[ptridx / unitbits] >> bitidx;
+        if (endidx - ptridx < n)
+        {
+            n = endidx - ptridx + 1;
+            if (n < unitbits)
+                markunit &= ((gc_markunit_t)0x01 << n) - 1;
+        }
+        if (markunit != 0)
+            return true;
+        ptridx += n;
+    }
+    return false;
+}
+
+/*
+ * Set the protection of 'n' pages starting from 'page'.
+ */
+static void gc_nursery_mprotect(size_t page, size_t n, int prot)
+{
+    if (n == 0)
+        return;
+    if (mprotect(GC_MEMORY + page*GC_PAGESIZE, n*GC_PAGESIZE, prot) != 0)
+        gc_handle_error(true, 0);
+}
+
+/*
+ * Write protect the pages holding old (marked) objects, and unprotect all
+ * other pages.  If 'protect' is false, all pages are unprotected.  Free
+ * memory is never protected.  Pages already in the right state are skipped,
+ * and runs of adjacent pages are (un)protected with a single mprotect().
+ */
+static void gc_nursery_protect(bool protect)
+{
+    for (size_t i = 0; i < GC_NUM_REGIONS; i++)
+    {
+        gc_region_t region = __gc_regions + i;
+        if (region->freeptr == region->startptr)
+            continue;
+        size_t page = gc_page_index(region->startptr);
+        size_t endpage = gc_page_index(region->freeptr - 1);
+        size_t runpage = page, runlen = 0;
+        int runprot = -1;
+        for (; page <= endpage; page++)
+        {
+            bool old = (protect && gc_is_marked_page(region, page));
+            int prot = -1;                      // No change.
+            switch (gc_page_map[page])
+            {
+                case GC_PAGE_UNPROTECTED:
+                    if (old)
+                        prot = PROT_READ;
+                    break;
+                case GC_PAGE_PROTECTED:
+                    if (!old)
+                        prot = PROT_READ | PROT_WRITE;
+                    break;
+                case GC_PAGE_DIRTY:
+                    if (old)
+                        prot = PROT_READ;
+                    break;
+            }
+            gc_page_map[page] = (old? GC_PAGE_PROTECTED: GC_PAGE_UNPROTECTED);
+            if (prot < 0)
+                continue;
+            if (prot == runprot && runpage + runlen == page)
+            {
+                runlen++;
+                continue;
+            }
+            gc_nursery_mprotect(runpage, runlen, runprot);
+            runpage = page;
+            runlen = 1;
+            runprot = prot;
+        }
+        gc_nursery_mprotect(runpage, runlen, runprot);
+    }
+}
+
+/*
+ * GC enable/disable minor collections.
+ */
+extern bool GC_nursery(bool on)
+{
+    if (!on)
+    {
+        if (!gc_generational)
+            return true;
+        gc_generational = false;
+        gc_nursery_protect(false);
+        sigaction(SIGSEGV, &gc_nursery_action, NULL);
+        return true;
+    }
+    if (gc_generational)
+        return true;
+    if (gc_remember_start == NULL)
+    {
+        void **ptr = (void **)gc_get_mark_memory(GC_REMEMBER_SIZE);
+        if (ptr == NULL)
+            return false;
+        uint8_t *map = (uint8_t *)gc_get_mark_memory(GC_PAGE_MAP_SIZE);
+        if (map == NULL)
+        {
+            gc_free_memory(ptr, GC_REMEMBER_SIZE);
+            return false;
+        }
+        gc_remember_start = ptr;
+        gc_remember_ptr   = ptr;
+        gc_remember_end   = ptr + GC_REMEMBER_SIZE / sizeof(void *);
+        gc_page_map       = map;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = gc_nursery_handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGSEGV, &action, &gc_nursery_action) != 0)
+        return false;
+    gc_generational = true;
+
+    // Writes before now were not tracked, so the first collection must be a
+    // major one (which also enables the write protection):
+    gc_remember_overflowed = true;
+    return true;
+}
+
+#else       /* __MINGW32__ */
+
+static void gc_nursery_protect(bool protect)
+{
+    return;
+}
+
+extern bool GC_nursery(bool on)
+{
+    if (!on)
+        return true;
+    errno = ENOSYS;
+    return false;
+}
+
+#endif      /* __MINGW32__ */
+
+/*
+ * GC set the number of mark threads.
+ */
+extern void GC_mark_threads(size_t n)
+{
+    if (n == 0 || n > GC_MARK_THREADS_MAX)
+    {
+        gc_handle_error(false, EINVAL);
+        return;
+    }
+    gc_mark_nthreads = n;
+}
+
 /*
  * GC sweeping.
+ *
+ * Sweeping is lazy: here we only reset the per-region allocation state and
+ * flag the region as needing a sweep.  The sweep itself (trimming the free
+ * space pointer and returning memory to the OS) is done by gc_sweep_region()
+ * the first time GC_malloc_index() runs out of free-list for that region.
+ * The big and huge regions hold few objects but most of the memory, so they
+ * are swept eagerly so that memory is still returned promptly.
  */
 static void gc_sweep(void)
 {
     static size_t sweep_count = 0;
     sweep_count++;
-    bool returning = (sweep_count % GC_RETURN_SWEEP == 0);
+    gc_sweep_returning = (sweep_count % GC_RETURN_SWEEP == 0);
 
     for (size_t i = 0; i < GC_NUM_REGIONS; i++)
     {
         gc_region_t region = __gc_regions + i;
         if (region->freeptr == region->startptr)
             continue;
-        void *ptr = region->freeptr - region->size;
-        uint32_t size = region->size;
-        uint8_t *markptr = region->markptr;
-
-        if (i == GC_BIG_IDX_OFFSET)
-            returning = true;
+        region->markstartptr = region->startptr;
+        region->markendptr = region->freeptr;
+        region->freelist = NULL;
+        region->sweep = true;
+        if (i >= GC_BIG_IDX_OFFSET)
+            gc_sweep_region(region, true);
+    }
+}
 
-        // Return memory to the OS:
-        int32_t ptridx = (int32_t)(gc_objidx(ptr) - region->startidx);
-        int32_t target = ptridx / 2, freesize = 0;
-        bool start = true;
-        while (true)
+/*
+ * GC sweep a single region.
+ */
+static void gc_sweep_region(gc_region_t region, bool returning)
+{
+    region->sweep = false;
+    if (region->freeptr == region->startptr)
+        return;
+    void *ptr = region->freeptr - region->size;
+    uint32_t size = region->size;
+    uint8_t *markptr = region->markptr;
+
+    // Return memory to the OS:
+    int32_t ptridx = (int32_t)(gc_objidx(ptr) - region->startidx);
+    int32_t target = ptridx / 2, freesize = 0;
+    bool start = true;
+    while (true)
+    {
+        if (ptridx < target || gc_is_marked_index(markptr, ptridx))
         {
-            if (ptridx < target || gc_is_marked_index(markptr, ptridx))
+            if (freesize >= 3*GC_PAGESIZE)
             {
-                if (freesize >= 3*GC_PAGESIZE)
-                {
-                    uint32_t offset = size * (ptridx + 1);
-                    int32_t diff = offset % GC_PAGESIZE;
-                    diff = (diff == 0? 0: GC_PAGESIZE - diff);
-                    offset += diff;
-                    freesize -= diff;
-                    void *freeptr = region->startptr + offset;
-                    freesize -= freesize % GC_PAGESIZE;
+                uint32_t offset = size * (ptridx + 1);
+                int32_t diff = offset % GC_PAGESIZE;
+                diff = (diff == 0? 0: GC_PAGESIZE - diff);
+                offset += diff;
+                freesize -= diff;
+                void *freeptr = region->startptr + offset;
+                freesize -= freesize % GC_PAGESIZE;
 #ifndef __MINGW32__
-                    madvise(freeptr, freesize, MADV_DONTNEED);
+                madvise(freeptr, freesize, MADV_DONTNEED);
 #endif      /* __MINGW32__ */
-                }
-                freesize = 0;
-                if (start)
-                {
-                    void *ptr = region->startptr + size * (ptridx + 1);
-                    region->freeptr = ptr;
-                    if (!returning)
-                        break;
-                    start = false;
-                }
-                if (ptridx < target)
+            }
+            freesize = 0;
+            if (start)
+            {
+                void *ptr = region->startptr + size * (ptridx + 1);
+                region->freeptr = ptr;
+                if (!returning)
                     break;
+                start = false;
             }
-            else
-                freesize += size;
-            ptridx--;
+            if (ptridx < target)
+                break;
         }
+        else
+            freesize += size;
+        ptridx--;
+    }
 
-        region->markstartptr = region->startptr;
-        region->markendptr = region->freeptr;
-        region->freelist = NULL;
+    region->markendptr = region->freeptr;
+}
+
+#ifdef PROPPROF
+/*
+ * Record a pause/sweep time.
+ */
+static void gc_histogram_record(struct gc_histogram_s *hist, uint64_t start)
+{
+    uint64_t cycles = __rdtsc() - start;
+    size_t i = (cycles == 0? 0: 63 - __builtin_clzll(cycles));
+    i = (i < GC_HISTOGRAM_LEN? i: GC_HISTOGRAM_LEN-1);
+    hist->count[i]++;
+    if (cycles > hist->max)
+        hist->max = cycles;
+}
+#endif      /* PROPPROF */
+
+/*
+ * GC pause/sweep time histograms.
+ */
+extern const struct gc_histogram_s *GC_histogram(gc_histogram_kind_t kind)
+{
+    switch (kind)
+    {
+        case GC_HISTOGRAM_PAUSE:
+            return &gc_pause_hist;
+        case GC_HISTOGRAM_SWEEP:
+            return &gc_sweep_hist;
+        default:
+            return NULL;
     }
 }
+extern void GC_histogram_reset(void)
+{
+    memset(&gc_pause_hist, 0, sizeof(gc_pause_hist));
+    memset(&gc_sweep_hist, 0, sizeof(gc_sweep_hist));
+}
 
 /*
  * GC strdup()
@@ -21,6 +21,7 @@
 
 #include <errno.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -114,6 +115,7 @@ struct gc_region_s
     void *markendptr;                           // Marked (end) pointer.
     uint8_t *markptr;                           // Mark memory pointer.
     size_t startidx;                            // Start objidx.
+    bool sweep;                                 // Lazy sweep pending?
 };
 typedef struct gc_region_s *gc_region_t;
 extern struct gc_region_s __gc_regions[GC_NUM_REGIONS];
@@ -371,6 +373,30 @@ extern bool GC_root(void *ptr, size_t size);
 extern bool GC_dynamic_root(void **ptrptr, size_t *sizeptr, size_t elemsize);
 #define gc_dynamic_root     GC_dynamic_root
 
+/*
+ * GC typed dynamic root registration.
+ *
+ * This is like GC_dynamic_root(), except that only the pointer words of each
+ * element are scanned.  Bit i of 'layout' is set iff word i of an element may
+ * be a GC pointer (see GC_LAYOUT()); a zero 'layout' scans every word, as
+ * with GC_dynamic_root().  The element size must be a multiple of the word
+ * size, and at most 64 words.
+ */
+extern bool GC_typed_root(void **ptrptr, size_t *sizeptr, size_t elemsize,
+    uint64_t layout);
+#define gc_typed_root       GC_typed_root
+
+/*
+ * GC layout of a field.
+ *
+ * The typed root layout bits for the (word aligned) field 'field' of
+ * 'type'.  Layouts of several fields may be combined with `|'.
+ */
+#define GC_LAYOUT(type, field)                                              \
+    ((((uint64_t)1 << (sizeof(((type *)NULL)->field) / sizeof(void *))) -   \
+        1) << (offsetof(type, field) / sizeof(void *)))
+#define gc_layout           GC_LAYOUT
+
 /*
  * GC memory allocation.
  *
@@ -397,6 +423,44 @@ GC_INLINE void *GC_malloc(size_t size)
 }
 #define gc_malloc           GC_malloc
 
+/*
+ * GC arena allocation.
+ *
+ * Between GC_arena_begin() and GC_arena_end(), GC_arena_malloc() allocates
+ * from a bump-pointer arena rather than the collected heap.  Arena memory is
+ * never collected, but the used part of the arena is scanned as a root, so
+ * any GC memory referenced by arena objects remains live.  GC_arena_end()
+ * releases the whole arena at once, so arena objects must not be used
+ * afterwards.  Outside of GC_arena_begin()/GC_arena_end(), or once the arena
+ * is full, GC_arena_malloc() is the same as GC_malloc().  Arena memory must
+ * not be passed to GC_realloc() or GC_free(); use GC_arena_free() instead.
+ *
+ * NOTE: struct gc_arena_s is PRIVATE!  Do not access/modify directly.
+ */
+struct gc_arena_s
+{
+    char *startptr;                             // Start pointer.
+    char *freeptr;                              // Free space pointer.
+    char *endptr;                               // End pointer.
+    bool on;                                    // Arena allocation on?
+};
+extern struct gc_arena_s __gc_arena;
+extern bool GC_arena_begin(void);
+extern void GC_arena_end(void);
+GC_INLINE void *GC_arena_malloc(size_t size)
+{
+    struct gc_arena_s *arena = &__gc_arena;
+    size = (size + GC_ALIGNMENT - 1) & ~((size_t)GC_ALIGNMENT - 1);
+    char *ptr = arena->freeptr;
+    if (!arena->on || (size_t)(arena->endptr - ptr) < size)
+        return GC_malloc(size);
+    arena->freeptr = ptr + size;
+    return (void *)ptr;
+}
+#define gc_arena_begin      GC_arena_begin
+#define gc_arena_end        GC_arena_end
+#define gc_arena_malloc     GC_arena_malloc
+
 /*
  * GC memory reallocation.
  *
@@ -422,6 +486,19 @@ GC_INLINE void GC_free(void *ptr)
 }
 #define gc_free             GC_free
 
+/*
+ * GC arena deallocation.
+ *
+ * Like GC_free(), but 'ptr' may also point into the arena (in which case
+ * this is a no-op).
+ */
+GC_INLINE void GC_arena_free(void *ptr)
+{
+    if (GC_isptr(ptr))
+        GC_free_nonnull(ptr);
+}
+#define gc_arena_free       GC_arena_free
+
 /*
  * GC garbage collection.
  *
@@ -430,6 +507,66 @@ GC_INLINE void GC_free(void *ptr)
 extern void GC_collect(void) __attribute__((__noinline__));
 #define gc_collect          GC_collect
 
+/*
+ * GC nursery (generational collection).
+ *
+ * GC_nursery(true) enables minor collections until GC_nursery(false).
+ * Objects allocated since the last collection form the nursery; a minor
+ * collection only marks nursery objects reachable from the roots or from old
+ * objects modified since the last collection, and promotes the survivors to
+ * the old generation.  Modified old objects are found by write protecting
+ * the pages holding old objects after each collection, so no explicit write
+ * barrier is needed.  A major (full) collection happens first, when the old
+ * generation has grown enough, or when GC_collect() is called.  Returns
+ * `false' (and sets errno) on failure.
+ *
+ * NOTE: The write protection is only handled for faults raised by user
+ *       code.  System calls that write to protected memory (e.g. read(2)
+ *       into a GC-allocated buffer) fail with EFAULT instead, so such
+ *       buffers must not be GC-allocated while minor collections are
+ *       enabled.
+ */
+extern bool GC_nursery(bool on);
+#define gc_nursery          GC_nursery
+
+/*
+ * GC pause/sweep time histograms.
+ *
+ * GC_HISTOGRAM_PAUSE records the duration of each collection, and
+ * GC_HISTOGRAM_SWEEP the duration of each lazy (allocation driven) region
+ * sweep.  Bucket i counts the events that took [2^i, 2^(i+1)) cycles.
+ * The histograms are only recorded by executables compiled with -D PROPPROF,
+ * and are empty otherwise.
+ */
+#define GC_HISTOGRAM_LEN    48
+enum gc_histogram_kind_e
+{
+    GC_HISTOGRAM_PAUSE,
+    GC_HISTOGRAM_SWEEP,
+};
+typedef enum gc_histogram_kind_e gc_histogram_kind_t;
+struct gc_histogram_s
+{
+    size_t count[GC_HISTOGRAM_LEN];             // Counts.
+    uint64_t max;                               // Max cycles.
+};
+extern const struct gc_histogram_s *GC_histogram(gc_histogram_kind_t kind);
+extern void GC_histogram_reset(void);
+#define gc_histogram        GC_histogram
+#define gc_histogram_reset  GC_histogram_reset
+
+/*
+ * GC mark threads.
+ *
+ * Set the number of threads (including the caller) used to mark during
+ * collection, from 1 (the default, sequential marking) up to
+ * GC_MARK_THREADS_MAX.  Helper threads are started lazily by the next
+ * collection and are never stopped, so the number of threads can only grow.
+ */
+#define GC_MARK_THREADS_MAX 64
+extern void GC_mark_threads(size_t n);
+#define gc_mark_threads     GC_mark_threads
+
 /*
  * GC strdup
  *
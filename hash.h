@@ -191,7 +191,8 @@ static inline bool ALWAYS_INLINE hash_iseq(hash_t x, hash_t y)
 #ifdef VINTAGE_AMD64
     return (x[0] == y[0] && x[1] == y[1]);
 #else
-    return (bool)__builtin_ia32_ptestc128(x, y);
+    hash_t d = x ^ y;
+    return (bool)__builtin_ia32_ptestz128(d, d);
 #endif      /* VINTAGE_AMD64 */
 }
 
@@ -27,12 +27,14 @@
 int isatty(int fd);     // Surpress warning.
 
 #include "debug.h"
+#include "dimacs.h"
 #include "options.h"
 #include "prompt.h"
 #include "server.h"
 #include "set.h"
 #include "show.h"
 #include "smchr.h"
+#include "solver.h"
 #include "stats.h"
 #include "term.h"
 
@@ -41,9 +43,17 @@ int isatty(int fd);     // Surpress warning.
  */
 enum option_e
 {
-    OPTION_DEBUG = 1000,
+    OPTION_CUBES = 1000,
+    OPTION_DEBUG,
+    OPTION_DIMACS,
+    OPTION_GC_NURSERY,
+    OPTION_GC_THREADS,
     OPTION_HELP,
     OPTION_INPUT,
+    OPTION_PHASE,
+    OPTION_PORTFOLIO,
+    OPTION_PROFILE,
+    OPTION_RESTART,
     OPTION_SCRIPT,
     OPTION_SERVER,
     OPTION_SILENT,
@@ -54,9 +64,17 @@ enum option_e
 typedef enum option_e option_t;
 static const struct option long_options[] =
 {
+    {"cubes", 1, NULL, OPTION_CUBES},
     {"debug", 0, NULL, OPTION_DEBUG},
+    {"dimacs", 0, NULL, OPTION_DIMACS},
+    {"gc-nursery", 0, NULL, OPTION_GC_NURSERY},
+    {"gc-threads", 1, NULL, OPTION_GC_THREADS},
     {"help", 0, NULL, OPTION_HELP},
     {"input", 1, NULL, OPTION_INPUT},
+    {"phase", 1, NULL, OPTION_PHASE},
+    {"portfolio", 1, NULL, OPTION_PORTFOLIO},
+    {"profile", 1, NULL, OPTION_PROFILE},
+    {"restart", 1, NULL, OPTION_RESTART},
     {"script", 0, NULL, OPTION_SCRIPT},
     {"server", 1, NULL, OPTION_SERVER},
     {"silent", 0, NULL, OPTION_SILENT},
@@ -76,9 +94,11 @@ static void print_help(FILE *out, const char *progname);
 static void print_banner(const char *progname);
 static void gc_error_handler(void);
 static void interrupt(int sig);
+static term_t parse_goal(const char *filename, const char *line);
+static void show_result(term_t t);
 static void show_answer(const char *msg, term_t answer);
 static void pretty_print(term_t t, bool more);
-static void command(const char *cmd);
+static void command(const char *filename, const char *cmd);
 
 /*
  * GC error handler.
@@ -107,6 +127,7 @@ int main(int argc, char **argv)
     option_silent = !isatty(fileno(stdout));
     uint16_t port = 0;
     const char *input_filename = NULL;
+    bool dimacs = false;
     while (true)
     {
         int idx;
@@ -115,15 +136,92 @@ int main(int argc, char **argv)
             break;
         switch (option)
         {
+            case OPTION_CUBES:
+            {
+                char *end;
+                size_t k = strtoul(optarg, &end, 10);
+                if (k == 0 || k > OPTION_CUBES_MAX ||
+                        (end != NULL && end[0] != '\0'))
+                    fatal("failed to parse number of cubes for `--cubes' "
+                        "option; expected a number 1-%u, found \"%s\"",
+                        OPTION_CUBES_MAX, optarg);
+                option_cubes = k;
+                break;
+            }
             case OPTION_DEBUG: case 'd':
                 option_debug = true;
                 break;
+            case OPTION_DIMACS:
+                dimacs = true;
+                break;
+            case OPTION_GC_NURSERY:
+                if (!gc_nursery(true))
+                    warning("failed to enable generational garbage "
+                        "collection: %s", strerror(errno));
+                break;
+            case OPTION_GC_THREADS:
+            {
+                char *end;
+                size_t n = strtoul(optarg, &end, 10);
+                if (n == 0 || n > GC_MARK_THREADS_MAX ||
+                        (end != NULL && end[0] != '\0'))
+                    fatal("failed to parse number of threads for "
+                        "`--gc-threads' option; expected a number 1-%u, "
+                        "found \"%s\"", GC_MARK_THREADS_MAX, optarg);
+                gc_mark_threads(n);
+                break;
+            }
             case OPTION_HELP:
                 print_help(stdout, argv[0]);
                 return EXIT_SUCCESS;
             case OPTION_INPUT:
                 input_filename = gc_strdup(optarg);
                 break;
+            case OPTION_PHASE:
+                if (strcmp(optarg, "score") == 0)
+                    option_phase = PHASE_SCORE;
+                else if (strcmp(optarg, "saved") == 0)
+                    option_phase = PHASE_SAVED;
+                else if (strcmp(optarg, "target") == 0)
+                    option_phase = PHASE_TARGET;
+                else
+                    fatal("expected phase mode score, saved or target, "
+                        "found \"%s\"", optarg);
+                break;
+            case OPTION_PORTFOLIO:
+            {
+                char *end;
+                size_t n = strtoul(optarg, &end, 10);
+                if (n == 0 || n > OPTION_PORTFOLIO_MAX ||
+                        (end != NULL && end[0] != '\0'))
+                    fatal("failed to parse number of workers for "
+                        "`--portfolio' option; expected a number 1-%u, "
+                        "found \"%s\"", OPTION_PORTFOLIO_MAX, optarg);
+                option_portfolio = n;
+                break;
+            }
+            case OPTION_PROFILE:
+#ifndef PROPPROF
+                fatal("`--profile' requires an executable compiled with "
+                    "-D PROPPROF");
+#endif
+                if (strcmp(optarg, "table") == 0)
+                    option_propprof = PROPPROF_TABLE;
+                else if (strcmp(optarg, "json") == 0)
+                    option_propprof = PROPPROF_JSON;
+                else
+                    fatal("expected profile format table or json, "
+                        "found \"%s\"", optarg);
+                break;
+            case OPTION_RESTART:
+                if (strcmp(optarg, "luby") == 0)
+                    option_restart = RESTART_LUBY;
+                else if (strcmp(optarg, "glucose") == 0)
+                    option_restart = RESTART_GLUCOSE;
+                else
+                    fatal("expected restart policy luby or glucose, "
+                        "found \"%s\"", optarg);
+                break;
             case OPTION_SERVER:
             {
                 char *end;
@@ -177,6 +275,11 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    if (!dimacs && input_filename != NULL)
+        dimacs = dimacs_detect(input_filename);
+    if (dimacs)
+        option_silent = true;
+
     if (!option_silent)
         print_banner(argv[0]);
 
@@ -213,6 +316,10 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    // DIMACS CNF input:
+    if (dimacs)
+        return dimacs_solve(input_filename);
+
     // Open input file if need be:
     FILE *input = stdin;
     if (input_filename != NULL)
@@ -237,32 +344,19 @@ int main(int argc, char **argv)
             continue;
         if (line[0] == ':')
         {
-            command(line + 1);
+            command(filename, line + 1);
             continue;
         }
-        size_t lineno = 1;
-        const char *err_str;
-        term_t t = parse_term(filename, &lineno, opinfo_init(), line, &err_str,
-            NULL);
+        term_t t = parse_goal(filename, line);
         if (t == (term_t)NULL)
         {
-            size_t cxt = 64;
-            char pre_err[cxt+1];
-            size_t offset = err_str - line, j = 0;
-            for (ssize_t i = (offset > cxt? offset - cxt: 0); i < offset; i++)
-                pre_err[j++] = line[i];
-            pre_err[j++] = '\0';
-            error("(%s: %zu) failed to parse goal; error is \"%s!y%s!d\" "
-                "<--- here ---> \"!y%.64s!d%s\"", filename, lineno,
-                (offset > cxt? "...": ""), pre_err, err_str,
-                (strlen(err_str) > cxt? "...": ""));
             if (option_script)
                 exit_code = EXIT_FAILURE;
             continue;
         }
 
         // (2) Execute the goal:
-        t = smchr_execute(filename, lineno, t);
+        t = smchr_execute(filename, 1, t);
 
         // (3) Interpret the result:
         if (option_script)
@@ -271,24 +365,57 @@ int main(int argc, char **argv)
                 exit_code = EXIT_FAILURE;
         }
 
-        if (type(t) == BOOL)
-        {
-            if (t == TERM_FALSE)
-                message("!rUNSAT!d");
-            else
-                show_answer("!gUNKNOWN!d", t);
-        }
-        else if (type(t) == NIL)
-            message("!yABORT!d");
-        else
-            show_answer("!gUNKNOWN!d", t);
-
+        show_result(t);
         stats_print();
+        solver_profile_print();
     }
 
     return exit_code;
 }
 
+/*
+ * Parse a goal.  Returns NULL on failure.
+ */
+static term_t parse_goal(const char *filename, const char *line)
+{
+    size_t lineno = 1;
+    const char *err_str;
+    term_t t = parse_term(filename, &lineno, opinfo_init(), line, &err_str,
+        NULL);
+    if (t == (term_t)NULL)
+    {
+        size_t cxt = 64;
+        char pre_err[cxt+1];
+        size_t offset = err_str - line, j = 0;
+        for (ssize_t i = (offset > cxt? offset - cxt: 0); i < offset; i++)
+            pre_err[j++] = line[i];
+        pre_err[j++] = '\0';
+        error("(%s: %zu) failed to parse goal; error is \"%s!y%s!d\" "
+            "<--- here ---> \"!y%.64s!d%s\"", filename, lineno,
+            (offset > cxt? "...": ""), pre_err, err_str,
+            (strlen(err_str) > cxt? "...": ""));
+    }
+    return t;
+}
+
+/*
+ * Print the result of a goal.
+ */
+static void show_result(term_t t)
+{
+    if (type(t) == BOOL)
+    {
+        if (t == TERM_FALSE)
+            message("!rUNSAT!d");
+        else
+            show_answer("!gUNKNOWN!d", t);
+    }
+    else if (type(t) == NIL)
+        message("!yABORT!d");
+    else
+        show_answer("!gUNKNOWN!d", t);
+}
+
 /*
  * Pretty print an answer.
  */
@@ -403,12 +530,64 @@ static void print_help(FILE *out, const char *progname)
     print_usage(out, progname, false);
     putc('\n', out);
     fputs("OPTIONS:\n", out);
+    fputs("\t--cubes K\n", out);
+    fputs("\t\tSplit each goal into (at most) K cubes using lookahead, and\n",
+        out);
+    fputs("\t\tsolve the cubes with a pool of worker processes (one per\n",
+        out);
+    fputs("\t\tCPU).\n", out);
     fputs("\t--debug, -d\n", out);
     fputs("\t\tEnable solver debugging mode.\n", out);
+    fputs("\t--dimacs\n", out);
+    fputs("\t\tRead the input as a DIMACS CNF problem (also used if the\n",
+        out);
+    fputs("\t\tinput file starts with a `p cnf' header).\n", out);
+    fputs("\t--gc-nursery\n", out);
+    fputs("\t\tEnable generational garbage collection: frequent minor\n",
+        out);
+    fputs("\t\tcollections of recently allocated memory, with occasional\n",
+        out);
+    fputs("\t\tfull collections.  Old objects are write protected, so\n",
+        out);
+    fputs("\t\tplugins must not pass GC memory to system calls that write\n",
+        out);
+    fputs("\t\tto it (these fail with EFAULT).\n", out);
+    fputs("\t--gc-threads N\n", out);
+    fputs("\t\tUse N threads to mark live memory during garbage collection\n",
+        out);
+    fputs("\t\t(default 1).\n", out);
     fputs("\t--help\n", out);
     fputs("\t\tPrints this helpful message and exits.\n", out);
     fputs("\t--input FILE\n", out);
     fputs("\t\tUse FILE instead of stdin as input.\n", out);
+    fputs("\t--phase MODE\n", out);
+    fputs("\t\tSets the decision polarity mode: `score' (most unsatisfied\n",
+        out);
+    fputs("\t\tclauses), `saved' (phase saving) or `target'\n", out);
+    fputs("\t\t(target phases with best-phase rephasing, default).\n", out);
+    fputs("\t--portfolio N\n", out);
+    fputs("\t\tSolve each goal with N parallel worker processes that use\n",
+        out);
+    fputs("\t\tdifferent search policies and share learnt clauses.  The\n",
+        out);
+    fputs("\t\tfirst answer wins (default 1, i.e. sequential).\n", out);
+    fputs("\t--profile FORMAT\n", out);
+    fputs("\t\tPrint per-propagator wakes, cycles, propagations, failures,\n",
+        out);
+    fputs("\t\tkills and purges after each goal, as a `table' (sorted by\n",
+        out);
+    fputs("\t\tcycles) or as `json', followed by the constraint store\n",
+        out);
+    fputs("\t\toperation latency and GC pause/sweep time histograms.\n",
+        out);
+    fputs("\t\tRequires an executable compiled with -D PROPPROF (see\n",
+        out);
+    fputs("\t\t`make smchr.propprof').\n", out);
+    fputs("\t--restart POLICY\n", out);
+    fputs("\t\tSets the restart policy: `luby' (fixed Luby sequence) or\n",
+        out);
+    fputs("\t\t`glucose' (adaptive, based on learnt clause LBD, default).\n",
+        out);
     fputs("\t--script\n", out);
     fputs("\t\tEnter script-mode.  The exit code will be 0 only if all "
         "goals\n", out);
@@ -447,10 +626,41 @@ static void interrupt(int sig)
 /*
  * Command interpreter.
  */
-static void command(const char *cmd)
+static void command(const char *filename, const char *cmd)
 {
+    size_t len = strcspn(cmd, " \t");
+    const char *arg = cmd + len;
+    while (isspace(*arg))
+        arg++;
     switch (cmd[0])
     {
+        case 'a':
+            if (len == 1 || (len == 6 && strncmp(cmd, "assert", len) == 0))
+            {
+                term_t t = parse_goal(filename, arg);
+                if (t == (term_t)NULL)
+                    return;
+                if (smchr_assert(filename, 1, t))
+                    message("[ASSERT]");
+                return;
+            }
+            break;
+        case 'c':
+            if (len == 1 || (len == 5 && strncmp(cmd, "check", len) == 0))
+            {
+                term_t t = parse_goal(filename, (*arg == '\0'? "true": arg));
+                if (t == (term_t)NULL)
+                    return;
+                term_t core;
+                t = smchr_check(filename, 1, t, &core);
+                show_result(t);
+                if (t == TERM_FALSE)
+                    show_answer("!rCORE!d", core);
+                stats_print();
+                solver_profile_print();
+                return;
+            }
+            break;
         case 'd':
             if (cmd[1] == '\0' || strcmp(cmd, "debug") == 0)
             {
@@ -470,6 +680,16 @@ static void command(const char *cmd)
             if (cmd[1] == '\0' || strcmp(cmd, "help") == 0)
             {
                 message("\nCOMMANDS:");
+                message("\t:a GOAL, :assert GOAL");
+                message("\t\tAdd GOAL to the current session (starting a "
+                    "new session if need be).");
+                message("\t:c GOAL, :check GOAL");
+                message("\t\tSolve the session under the assumptions GOAL "
+                    "(a conjunction).");
+                message("\t\tLearnt clauses are kept between checks.  An "
+                    "UNSAT result is");
+                message("\t\tfollowed by an unsat core over the "
+                    "assumptions.");
                 message("\t:d, :debug");
                 message("\t\tEnter DEBUG mode.");
                 message("\t:h, :help");
@@ -478,6 +698,8 @@ static void command(const char *cmd)
                 message("\t\tDisable DEBUG mode.");
                 message("\t:q, :quit");
                 message("\t\tQuit SMCHR.");
+                message("\t:r, :reset");
+                message("\t\tEnd the current session.");
                 message("");
                 return;
             }
@@ -489,6 +711,14 @@ static void command(const char *cmd)
                 return;
             }
             break;
+        case 'r':
+            if (len == 1 || (len == 5 && strncmp(cmd, "reset", len) == 0))
+            {
+                message("[RESET]");
+                smchr_end();
+                return;
+            }
+            break;
         default:
             break;
     }
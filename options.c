@@ -27,4 +27,9 @@ bool option_eq = false;
 bool option_script = OPTION_SCRIPT_DEFAULT;
 bool option_silent = OPTION_SILENT_DEFAULT;
 int option_verbosity = OPTION_VERBOSITY_DEFAULT;
+phase_t option_phase = OPTION_PHASE_DEFAULT;
+restart_t option_restart = OPTION_RESTART_DEFAULT;
+size_t option_portfolio = OPTION_PORTFOLIO_DEFAULT;
+size_t option_cubes = OPTION_CUBES_DEFAULT;
+propprof_t option_propprof = PROPPROF_NONE;
 
@@ -19,6 +19,7 @@
 #define __OPTIONS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /*
  * Default values.
@@ -27,6 +28,46 @@
 #define OPTION_SCRIPT_DEFAULT       false
 #define OPTION_SILENT_DEFAULT       false
 #define OPTION_VERBOSITY_DEFAULT    9
+#define OPTION_PHASE_DEFAULT        PHASE_TARGET
+#define OPTION_RESTART_DEFAULT      RESTART_GLUCOSE
+#define OPTION_PORTFOLIO_DEFAULT    1
+#define OPTION_PORTFOLIO_MAX        256
+#define OPTION_CUBES_DEFAULT        0
+#define OPTION_CUBES_MAX            1024
+
+/*
+ * Decision polarity modes.
+ */
+enum phase_e
+{
+    PHASE_SCORE,                // Most unsatisfied watched clauses.
+    PHASE_SAVED,                // Saved phase (last assigned sign).
+    PHASE_TARGET,               // Target/best phase with rephasing.
+    PHASE_MAX                   // Number of modes (must be last).
+};
+typedef enum phase_e phase_t;
+
+/*
+ * Restart policies.
+ */
+enum restart_e
+{
+    RESTART_LUBY,               // Luby sequence.
+    RESTART_GLUCOSE,            // Adaptive (learnt clause LBD averages).
+    RESTART_MAX                 // Number of policies (must be last).
+};
+typedef enum restart_e restart_t;
+
+/*
+ * Propagator profile output (PROPPROF builds only).
+ */
+enum propprof_e
+{
+    PROPPROF_NONE,              // No profile.
+    PROPPROF_TABLE,             // Table sorted by cycles.
+    PROPPROF_JSON               // JSON array.
+};
+typedef enum propprof_e propprof_t;
 
 /*
  * Various options.
@@ -37,5 +78,10 @@ extern bool option_script;
 extern bool option_eq;
 extern bool option_silent;
 extern int  option_verbosity;
+extern phase_t option_phase;
+extern restart_t option_restart;
+extern size_t option_portfolio;
+extern size_t option_cubes;
+extern propprof_t option_propprof;
 
 #endif      /* __OPTIONS_H */
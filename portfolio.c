@@ -0,0 +1,523 @@
+/*
+ * portfolio.c
+ * Copyright (C) 2018 National University of Singapore
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "misc.h"
+
+#ifndef WINDOWS
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "options.h"
+#include "portfolio.h"
+#include "sat.h"
+#include "solver.h"
+#include "stats.h"
+
+#define PORTFOLIO_SLOTS             16384
+#define PORTFOLIO_MODEL_SIZE        0x3FFFFFFF
+
+/*
+ * A ring buffer slot.  Each slot is protected by a sequence lock: the stamp
+ * of the clause with sequence number 'seq' is (2*seq+1) while the clause is
+ * being written, and (2*seq+2) once it is complete.
+ */
+struct slot_s
+{
+    uint64_t stamp;             // Sequence stamp.
+    uint32_t worker;            // Exporting worker.
+    uint32_t length;            // Clause length.
+    uint32_t lbd;               // Clause LBD.
+    uint32_t pad;
+    literal_t lits[PORTFOLIO_CLAUSE_MAX];   // Clause literals.
+};
+typedef struct slot_s *slot_t;
+
+/*
+ * The shared state.
+ */
+struct ring_s
+{
+    uint64_t head;              // Next sequence number.
+    int32_t winner;             // Winning worker (-1 if none).
+    struct slot_s slots[PORTFOLIO_SLOTS];   // Shared clauses.
+};
+typedef struct ring_s *ring_t;
+
+/*
+ * Result message (sent from the winner to the parent).
+ */
+struct message_s
+{
+    int32_t result;             // Result (result_t).
+    uint32_t worker;            // Winning worker.
+    size_t length;              // Model length.
+};
+
+/*
+ * Cube-and-conquer shared state.
+ */
+struct cube_s
+{
+    int32_t result;             // Cube result (-1 if none).
+    size_t time;                // Cube time (ns).
+};
+struct cubes_s
+{
+    int64_t winner;             // First SAT cube (-1 if none).
+    struct cube_s cubes[];      // Per-cube results.
+};
+typedef struct cubes_s *cubes_t;
+
+/*
+ * Worker state.
+ */
+bool portfolio_on = false;
+static ring_t portfolio_ring;       // Shared ring buffer.
+static uint32_t portfolio_id;       // Worker ID.
+static uint64_t portfolio_tail;     // Next clause to import.
+static uint64_t portfolio_own;      // Exports since the last import.
+
+/*
+ * Prototypes.
+ */
+#ifndef WINDOWS
+static void portfolio_worker(uint32_t id, int fd) NO_RETURN;
+static bool portfolio_read(int fd, void *buf, size_t size);
+static bool portfolio_write(int fd, const void *buf, size_t size);
+static void portfolio_cube_worker(cubes_t shared, literal_t *model,
+    literal_t *cube, size_t idx) NO_RETURN;
+#endif
+
+/*
+ * Solve the loaded goal.
+ */
+extern result_t portfolio_run(void)
+{
+    if (option_cubes > 1)
+        return portfolio_cubes(option_cubes);
+    if (option_portfolio > 1)
+        return portfolio_solve(option_portfolio);
+    return solve(NULL);
+}
+
+/*
+ * Portfolio solving.
+ */
+extern result_t portfolio_solve(size_t n)
+{
+#ifdef WINDOWS
+    warning("portfolio solving is not supported on this platform");
+    return solve(NULL);
+#else
+    ring_t ring = (ring_t)mmap(NULL, sizeof(struct ring_s),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED)
+    {
+        warning("failed to allocate portfolio ring buffer: %s",
+            strerror(errno));
+        return solve(NULL);
+    }
+    ring->head   = 0;
+    ring->winner = -1;
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        warning("failed to create portfolio pipe: %s", strerror(errno));
+        munmap(ring, sizeof(struct ring_s));
+        return solve(NULL);
+    }
+    portfolio_ring = ring;
+
+    // (1) Fork the workers:
+    fflush(NULL);
+    pid_t pids[n];
+    size_t m = 0;
+    for (; m < n; m++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            warning("failed to fork portfolio worker: %s", strerror(errno));
+            break;
+        }
+        if (pid == 0)
+        {
+            close(fds[0]);
+            portfolio_worker((uint32_t)m, fds[1]);
+        }
+        pids[m] = pid;
+    }
+    close(fds[1]);
+
+    // (2) Wait for the first answer.  If every worker exits without an
+    //     answer (e.g. errors), the pipe is closed and the read fails.
+    struct message_s msg;
+    literal_t *model = NULL;
+    bool ok = (m > 0 && portfolio_read(fds[0], &msg, sizeof(msg)));
+    if (ok && msg.result == RESULT_UNKNOWN)
+    {
+        model = (literal_t *)buffer_alloc(PORTFOLIO_MODEL_SIZE);
+        ok = portfolio_read(fds[0], model, msg.length * sizeof(literal_t));
+        model[ok? msg.length: 0] = LITERAL_NIL;
+    }
+
+    // (3) Stop the workers (kill() is shadowed by the solver macro):
+    for (size_t i = 0; i < m; i++)
+        (kill)(pids[i], SIGKILL);
+    for (size_t i = 0; i < m; i++)
+        waitpid(pids[i], NULL, 0);
+    close(fds[0]);
+    munmap(ring, sizeof(struct ring_s));
+    portfolio_ring = NULL;
+
+    // (4) Reconstruct the result:
+    result_t result = RESULT_ERROR;
+    if (m == 0)
+        result = solve(NULL);
+    else if (ok && msg.result == RESULT_UNSAT)
+        result = RESULT_UNSAT;
+    else if (ok && msg.result == RESULT_UNKNOWN)
+        result = solve(model);
+    if (model != NULL)
+        buffer_free(model, PORTFOLIO_MODEL_SIZE);
+    return result;
+#endif
+}
+
+#ifndef WINDOWS
+/*
+ * Portfolio worker.  Worker 0 uses the configured options; the others vary
+ * the restart policy, the phase policy and the random seed.
+ */
+static void portfolio_worker(uint32_t id, int fd)
+{
+    portfolio_on   = true;
+    portfolio_id   = id;
+    portfolio_tail = 0;
+    portfolio_own  = 0;
+    option_debug_on = false;
+    if (id > 0)
+    {
+        option_restart = (restart_t)((option_restart + id) % RESTART_MAX);
+        option_phase   = (phase_t)((option_phase + id / RESTART_MAX) %
+            PHASE_MAX);
+        sat_seed(id);
+    }
+
+    result_t result = solve(NULL);
+    int32_t winner = -1;
+    if (result != RESULT_ERROR &&
+        __atomic_compare_exchange_n(&portfolio_ring->winner, &winner,
+            (int32_t)id, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        struct message_s msg;
+        msg.result = (int32_t)result;
+        msg.worker = id;
+        msg.length = 0;
+        literal_t *model = NULL;
+        if (result == RESULT_UNKNOWN)
+        {
+            model = (literal_t *)buffer_alloc(PORTFOLIO_MODEL_SIZE);
+            msg.length = sat_get_model(model);
+        }
+        if (portfolio_write(fd, &msg, sizeof(msg)))
+            portfolio_write(fd, model, msg.length * sizeof(literal_t));
+    }
+    close(fd);
+    _exit(EXIT_SUCCESS);
+}
+
+/*
+ * Read exactly 'size' bytes.
+ */
+static bool portfolio_read(int fd, void *buf, size_t size)
+{
+    char *ptr = (char *)buf;
+    while (size > 0)
+    {
+        ssize_t r = read(fd, ptr, size);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return false;
+        ptr += r;
+        size -= (size_t)r;
+    }
+    return true;
+}
+
+/*
+ * Write exactly 'size' bytes.
+ */
+static bool portfolio_write(int fd, const void *buf, size_t size)
+{
+    const char *ptr = (const char *)buf;
+    while (size > 0)
+    {
+        ssize_t r = write(fd, ptr, size);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return false;
+        ptr += r;
+        size -= (size_t)r;
+    }
+    return true;
+}
+#endif
+
+/*
+ * Share a learnt clause.
+ */
+extern void portfolio_export(const literal_t *lits, size_t len, uint32_t lbd)
+{
+    if (len > PORTFOLIO_CLAUSE_MAX)
+        return;
+    ring_t ring = portfolio_ring;
+    uint64_t seq = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    slot_t slot = ring->slots + (seq % PORTFOLIO_SLOTS);
+    __atomic_store_n(&slot->stamp, 2*seq+1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&slot->worker, portfolio_id, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->length, (uint32_t)len, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->lbd, lbd, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < len; i++)
+        __atomic_store_n(&slot->lits[i], lits[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->stamp, 2*seq+2, __ATOMIC_RELEASE);
+    portfolio_own++;
+}
+
+/*
+ * Get the next shared clause.
+ */
+extern size_t portfolio_import(literal_t *lits, uint32_t *lbd)
+{
+    ring_t ring = portfolio_ring;
+    while (true)
+    {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (portfolio_tail >= head)
+        {
+            portfolio_own = 0;
+            return 0;
+        }
+        if (head - portfolio_tail > PORTFOLIO_SLOTS)
+            portfolio_tail = head - PORTFOLIO_SLOTS;    // Overrun.
+        uint64_t seq = portfolio_tail;
+        slot_t slot = ring->slots + (seq % PORTFOLIO_SLOTS);
+        uint64_t stamp = __atomic_load_n(&slot->stamp, __ATOMIC_ACQUIRE);
+        if (stamp < 2*seq+2)
+        {
+            // Not yet written; try again later.
+            portfolio_own = 0;
+            return 0;
+        }
+        portfolio_tail++;
+        if (stamp != 2*seq+2)
+            continue;                                   // Overwritten.
+        uint32_t worker = __atomic_load_n(&slot->worker, __ATOMIC_RELAXED);
+        uint32_t len = __atomic_load_n(&slot->length, __ATOMIC_RELAXED);
+        *lbd = __atomic_load_n(&slot->lbd, __ATOMIC_RELAXED);
+        if (len > PORTFOLIO_CLAUSE_MAX)
+            len = 0;
+        for (size_t i = 0; i < len; i++)
+            lits[i] = __atomic_load_n(&slot->lits[i], __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->stamp, __ATOMIC_RELAXED) != stamp)
+            continue;                                   // Torn read.
+        if (worker == portfolio_id || len == 0)
+            continue;
+        return len;
+    }
+}
+
+/*
+ * Test for pending shared clauses.
+ */
+extern bool portfolio_pending(void)
+{
+    uint64_t head = __atomic_load_n(&portfolio_ring->head, __ATOMIC_RELAXED);
+    return (head - portfolio_tail > portfolio_own);
+}
+
+/*
+ * Cube-and-conquer.
+ */
+extern result_t portfolio_cubes(size_t k)
+{
+#ifdef WINDOWS
+    warning("cube-and-conquer solving is not supported on this platform");
+    return solve(NULL);
+#else
+    // (1) Split the problem:
+    size_t depth = 0;
+    while (((size_t)1 << depth) < k)
+        depth++;
+    literal_t *cubes = (literal_t *)buffer_alloc(PORTFOLIO_MODEL_SIZE);
+    size_t n = sat_cubes(depth, cubes);
+    stat_cubes = n;
+    if (n == 0)
+    {
+        buffer_free(cubes, PORTFOLIO_MODEL_SIZE);
+        return RESULT_UNSAT;
+    }
+    size_t offsets[n];
+    for (size_t i = 0, j = 0; i < n; i++)
+    {
+        offsets[i] = j;
+        while (cubes[j] != LITERAL_NIL)
+            j++;
+        j++;
+    }
+
+    // (2) Shared state:
+    size_t size = sizeof(struct cubes_s) + n * sizeof(struct cube_s);
+    cubes_t shared = (cubes_t)mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    literal_t *model = (literal_t *)mmap(NULL, PORTFOLIO_MODEL_SIZE,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE,
+        -1, 0);
+    if (shared == MAP_FAILED || model == MAP_FAILED)
+        panic("failed to allocate shared memory for %zu cubes: %s", n,
+            strerror(errno));
+    shared->winner = -1;
+    for (size_t i = 0; i < n; i++)
+        shared->cubes[i].result = -1;
+
+    // (3) Solve the cubes with a pool of workers:
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers = (num_cpus < 1? 1: (size_t)num_cpus);
+    pid_t pids[workers];
+    size_t idxs[workers];
+    size_t running = 0, next = 0, refuted = 0;
+    bool stop = false, error = false;
+    fflush(NULL);
+    while (true)
+    {
+        while (!stop && running < workers && next < n)
+        {
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                warning("failed to fork cube worker: %s", strerror(errno));
+                if (running == 0)
+                    stop = error = true;
+                break;
+            }
+            if (pid == 0)
+                portfolio_cube_worker(shared, model, cubes + offsets[next],
+                    next);
+            pids[running] = pid;
+            idxs[running] = next;
+            running++;
+            next++;
+        }
+        if (running == 0)
+            break;
+        pid_t pid = waitpid(-1, NULL, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            panic("failed to wait for cube worker: %s", strerror(errno));
+        }
+        size_t j;
+        for (j = 0; j < running && pids[j] != pid; j++)
+            ;
+        if (j >= running)
+            continue;
+        size_t idx = idxs[j];
+        running--;
+        pids[j] = pids[running];
+        idxs[j] = idxs[running];
+
+        struct cube_s *cube = shared->cubes + idx;
+        const char *name;
+        switch (cube->result)
+        {
+            case RESULT_UNSAT:
+                name = "UNSAT";
+                refuted++;
+                break;
+            case RESULT_UNKNOWN:
+                name = "SAT";
+                stop = true;
+                break;
+            default:
+                name = "ERROR";
+                error = true;
+                break;
+        }
+        stats_cube(idx, name, cube->time);
+        if (shared->winner == (int64_t)idx)
+        {
+            // Stop the other workers:
+            for (size_t i = 0; i < running; i++)
+                (kill)(pids[i], SIGKILL);
+            for (size_t i = 0; i < running; i++)
+                waitpid(pids[i], NULL, 0);
+            running = 0;
+        }
+    }
+
+    // (4) Reconstruct the result:
+    result_t result = RESULT_ERROR;
+    if (shared->winner >= 0)
+        result = solve(model);
+    else if (!error && refuted == n)
+        result = RESULT_UNSAT;
+    munmap(model, PORTFOLIO_MODEL_SIZE);
+    munmap(shared, size);
+    buffer_free(cubes, PORTFOLIO_MODEL_SIZE);
+    return result;
+#endif
+}
+
+#ifndef WINDOWS
+/*
+ * Cube worker: solve the problem under the cube (as choices).
+ */
+static void portfolio_cube_worker(cubes_t shared, literal_t *model,
+    literal_t *cube, size_t idx)
+{
+    option_debug_on = false;
+    size_t start = timer();
+    result_t result = solve(cube);
+    shared->cubes[idx].time = timer() - start;
+    int64_t winner = -1;
+    if (result == RESULT_UNKNOWN &&
+        __atomic_compare_exchange_n(&shared->winner, &winner, (int64_t)idx,
+            false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        size_t len = sat_get_model(model);
+        model[len] = LITERAL_NIL;
+    }
+    shared->cubes[idx].result = (int32_t)result;
+    _exit(EXIT_SUCCESS);
+}
+#endif
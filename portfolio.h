@@ -0,0 +1,82 @@
+/*
+ * portfolio.h
+ * Copyright (C) 2018 National University of Singapore
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __PORTFOLIO_H
+#define __PORTFOLIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sat.h"
+#include "solver.h"
+
+/*
+ * Maximum length of a shared learnt clause.
+ */
+#define PORTFOLIO_CLAUSE_MAX        26
+
+/*
+ * Is this process a portfolio worker?
+ */
+extern bool portfolio_on;
+
+/*
+ * Solve the loaded goal with 'n' forked workers.  Each worker uses a
+ * different random seed, restart policy and phase policy, and the first
+ * definitive answer wins.  Learnt clauses are exchanged between the workers
+ * via a shared-memory ring buffer.  If the winner found a solution, the
+ * search is replayed in the calling process (using the winner's assignment
+ * as the decisions), so the solver state can be converted into an answer as
+ * usual.
+ */
+extern result_t portfolio_solve(size_t n);
+
+/*
+ * Solve the loaded goal by cube-and-conquer.  A lookahead phase splits the
+ * problem into (at most) 'k' cubes of decisions.  The cubes are solved as
+ * `choices' by a pool of forked workers (one per CPU).  The search stops at
+ * the first solution, which is replayed in the calling process.  The result
+ * is UNSAT only if every cube is refuted.  Per-cube timings are recorded in
+ * the stats.
+ */
+extern result_t portfolio_cubes(size_t k);
+
+/*
+ * Solve the loaded goal using the parallel mode selected by the options (if
+ * any).
+ */
+extern result_t portfolio_run(void);
+
+/*
+ * Share a learnt clause with the other workers.
+ */
+extern void portfolio_export(const literal_t *lits, size_t len, uint32_t lbd);
+
+/*
+ * Get the next clause shared by another worker.  Returns the clause length,
+ * or 0 if there are no more clauses.  'lits' must have room for
+ * PORTFOLIO_CLAUSE_MAX literals.
+ */
+extern size_t portfolio_import(literal_t *lits, uint32_t *lbd);
+
+/*
+ * Test if other workers have shared clauses not yet imported.
+ */
+extern bool portfolio_pending(void);
+
+#endif      /* __PORTFOLIO_H */
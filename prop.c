@@ -19,8 +19,13 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+#ifdef PROPPROF
+#include <x86intrin.h>
+#endif
+
 #include "solver.h"
 
 #define MAX_PRIORITY        8
@@ -37,6 +42,26 @@ static struct propqueue_s propqueue[MAX_PRIORITY] = {{0}};
 static uint_t priority = MAX_PRIORITY;
 static prop_t current = NULL;
 
+#ifdef PROPPROF
+/*
+ * Propagator profiling state.
+ */
+static sym_t *profile_syms = NULL;
+static size_t profile_syms_len = 0;
+static size_t profile_syms_size = 0;
+static propinfo_t profile_info = NULL;
+static uint64_t profile_start;
+
+/*
+ * A profile table entry.
+ */
+struct profile_entry_s
+{
+    sym_t sym;
+    size_t idx;
+};
+#endif      /* PROPPROF */
+
 /*
  * Reset the propagator queue.
  */
@@ -123,7 +148,16 @@ extern bool solver_wake_prop(void)
     sym_t sym = c->sym;
     propinfo_t info = sym->propinfo + solver_propinfo_index(prop);
     current = prop;
+#ifdef PROPPROF
+    info->prof.wakes++;
+    profile_info = info;
+    profile_start = __rdtsc();
+#endif
     info->handler(prop);
+#ifdef PROPPROF
+    info->prof.cycles += __rdtsc() - profile_start;
+    profile_info = NULL;
+#endif
     if (current != NULL)
     {
         current = NULL;
@@ -179,3 +213,251 @@ extern void solver_flush_queue(void)
     }
 }
 
+
+/*
+ * Register a symbol's propagators for profiling.
+ */
+extern void solver_profile_register(sym_t sym)
+{
+#ifdef PROPPROF
+    if (profile_syms_len >= profile_syms_size)
+    {
+        profile_syms_size = (profile_syms_size == 0? 64: 2*profile_syms_size);
+        profile_syms = (sym_t *)realloc(profile_syms,
+            profile_syms_size*sizeof(sym_t));
+        if (profile_syms == NULL)
+            panic("failed to allocate profile table: %s", strerror(errno));
+    }
+    profile_syms[profile_syms_len++] = sym;
+#endif      /* PROPPROF */
+}
+
+/*
+ * Profiling hooks.
+ */
+extern void solver_profile_propagate(void)
+{
+#ifdef PROPPROF
+    if (profile_info != NULL)
+        profile_info->prof.propagations++;
+#endif      /* PROPPROF */
+}
+extern void solver_profile_abort(bool fail)
+{
+#ifdef PROPPROF
+    // The handler has been aborted by FAIL or RESTART:
+    if (profile_info == NULL)
+        return;
+    profile_info->prof.cycles += __rdtsc() - profile_start;
+    if (fail)
+        profile_info->prof.failures++;
+    profile_info = NULL;
+#endif      /* PROPPROF */
+}
+extern void solver_profile_kill(prop_t prop)
+{
+#ifdef PROPPROF
+    cons_t c = constraint(prop);
+    propinfo_t info = c->sym->propinfo + solver_propinfo_index(prop);
+    info->prof.kills++;
+#endif      /* PROPPROF */
+}
+extern void solver_profile_purge(cons_t c)
+{
+#ifdef PROPPROF
+    sym_t sym = c->sym;
+    for (size_t i = 0; i < sym->propinfo_len; i++)
+        sym->propinfo[i].prof.purges++;
+#endif      /* PROPPROF */
+}
+
+/*
+ * Reset the profile.
+ */
+extern void solver_profile_reset(void)
+{
+#ifdef PROPPROF
+    for (size_t i = 0; i < profile_syms_len; i++)
+    {
+        sym_t sym = profile_syms[i];
+        for (size_t j = 0; j < sym->propinfo_len; j++)
+            memset(&sym->propinfo[j].prof, 0, sizeof(struct propprof_s));
+    }
+    profile_info = NULL;
+    solver_store_profile_reset();
+    gc_histogram_reset();
+#endif      /* PROPPROF */
+}
+
+#ifdef PROPPROF
+/*
+ * Compare profile entries (most cycles first).
+ */
+static int profile_compare(const void *a, const void *b)
+{
+    const struct profile_entry_s *ea = (const struct profile_entry_s *)a;
+    const struct profile_entry_s *eb = (const struct profile_entry_s *)b;
+    uint64_t ca = ea->sym->propinfo[ea->idx].prof.cycles;
+    uint64_t cb = eb->sym->propinfo[eb->idx].prof.cycles;
+    if (ca != cb)
+        return (ca > cb? -1: 1);
+    int cmp = strcmp(ea->sym->name, eb->sym->name);
+    if (cmp != 0)
+        return cmp;
+    if (ea->sym->arity != eb->sym->arity)
+        return (ea->sym->arity < eb->sym->arity? -1: 1);
+    return (ea->idx < eb->idx? -1: 1);
+}
+
+/*
+ * Print a JSON string.
+ */
+static void profile_print_json_string(const char *str)
+{
+    message_0("\"");
+    for (; *str != '\0'; str++)
+    {
+        switch (*str)
+        {
+            case '"': case '\\':
+                message_0("\\%c", *str);
+                break;
+            default:
+                if ((unsigned char)*str < 0x20)
+                    message_0("\\u%.4x", (unsigned)*str);
+                else
+                    message_0("%c", *str);
+                break;
+        }
+    }
+    message_0("\"");
+}
+
+/*
+ * Print the GC pause/sweep time histograms.
+ */
+static void profile_print_gc(void)
+{
+    static const char *names[] = {"pause", "sweep"};
+    static const gc_histogram_kind_t kinds[] =
+        {GC_HISTOGRAM_PAUSE, GC_HISTOGRAM_SWEEP};
+    switch (option_propprof)
+    {
+        case PROPPROF_TABLE:
+            message("GC_TIME %-8s %24s %12s", "EVENT", "CYCLES", "COUNT");
+            for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+            {
+                const struct gc_histogram_s *hist = gc_histogram(kinds[k]);
+                for (size_t i = 0; i < GC_HISTOGRAM_LEN; i++)
+                {
+                    if (hist->count[i] == 0)
+                        continue;
+                    char range[32];
+                    snprintf(range, sizeof(range), "%llu-%llu",
+                        1ull << i, (1ull << (i+1)) - 1);
+                    message("GC_TIME %-8s %24s %12zu", names[k], range,
+                        hist->count[i]);
+                }
+                message("GC_TIME %-8s %24s %12llu", names[k], "max",
+                    (unsigned long long)hist->max);
+            }
+            break;
+        case PROPPROF_JSON:
+            message_0("GC_TIME {");
+            for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+            {
+                const struct gc_histogram_s *hist = gc_histogram(kinds[k]);
+                size_t len = GC_HISTOGRAM_LEN;
+                while (len > 0 && hist->count[len-1] == 0)
+                    len--;
+                message_0("%s\"%s\":{\"max\":%llu,\"log2_cycles\":[",
+                    (k == 0? "": ","), names[k],
+                    (unsigned long long)hist->max);
+                for (size_t i = 0; i < len; i++)
+                    message_0("%s%zu", (i == 0? "": ","), hist->count[i]);
+                message_0("]}");
+            }
+            message("}");
+            break;
+        default:
+            break;
+    }
+}
+#endif      /* PROPPROF */
+
+/*
+ * Print the profile.
+ */
+extern void solver_profile_print(void)
+{
+#ifdef PROPPROF
+    if (option_propprof == PROPPROF_NONE)
+        return;
+
+    size_t len = 0;
+    for (size_t i = 0; i < profile_syms_len; i++)
+        len += profile_syms[i]->propinfo_len;
+    struct profile_entry_s *entries = (struct profile_entry_s *)malloc(
+        (len+1)*sizeof(struct profile_entry_s));
+    if (entries == NULL)
+        panic("failed to allocate profile table: %s", strerror(errno));
+    len = 0;
+    for (size_t i = 0; i < profile_syms_len; i++)
+    {
+        sym_t sym = profile_syms[i];
+        for (size_t j = 0; j < sym->propinfo_len; j++)
+        {
+            struct propprof_s *prof = &sym->propinfo[j].prof;
+            if (prof->wakes == 0 && prof->kills == 0 && prof->purges == 0)
+                continue;
+            entries[len].sym = sym;
+            entries[len].idx = j;
+            len++;
+        }
+    }
+    qsort(entries, len, sizeof(struct profile_entry_s), profile_compare);
+
+    switch (option_propprof)
+    {
+        case PROPPROF_TABLE:
+            message("PROFILE %-24s %4s %10s %14s %12s %10s %10s %10s",
+                "SYMBOL", "IDX", "WAKES", "CYCLES", "PROPAGATIONS",
+                "FAILURES", "KILLS", "PURGES");
+            for (size_t i = 0; i < len; i++)
+            {
+                sym_t sym = entries[i].sym;
+                struct propprof_s *prof = &sym->propinfo[entries[i].idx].prof;
+                char name[64];
+                snprintf(name, sizeof(name), "%s/%zu", sym->name,
+                    sym->arity);
+                message("PROFILE %-24s %4zu %10zu %14llu %12zu %10zu %10zu "
+                    "%10zu", name, entries[i].idx, prof->wakes,
+                    (unsigned long long)prof->cycles, prof->propagations,
+                    prof->failures, prof->kills, prof->purges);
+            }
+            break;
+        case PROPPROF_JSON:
+            message_0("PROFILE [");
+            for (size_t i = 0; i < len; i++)
+            {
+                sym_t sym = entries[i].sym;
+                struct propprof_s *prof = &sym->propinfo[entries[i].idx].prof;
+                message_0("%s{\"symbol\":", (i == 0? "": ","));
+                profile_print_json_string(sym->name);
+                message_0(",\"arity\":%zu,\"index\":%zu,\"wakes\":%zu,"
+                    "\"cycles\":%llu,\"propagations\":%zu,\"failures\":%zu,"
+                    "\"kills\":%zu,\"purges\":%zu}", sym->arity,
+                    entries[i].idx, prof->wakes,
+                    (unsigned long long)prof->cycles, prof->propagations,
+                    prof->failures, prof->kills, prof->purges);
+            }
+            message("]");
+            break;
+        default:
+            break;
+    }
+    free(entries);
+    solver_store_profile_print();
+    profile_print_gc();
+#endif      /* PROPPROF */
+}
@@ -27,6 +27,7 @@
 #include "log.h"
 #include "misc.h"
 #include "options.h"
+#include "portfolio.h"
 #include "sat.h"
 #include "show.h"
 #include "solver.h"
@@ -35,9 +36,27 @@
 /*
  * Tuning.
  */
-#define SAT_DECAY               128
+#define SAT_VAR_DECAY           0.95
+#define SAT_VAR_RESCALE         1e100
 #define SAT_RESTART             256
+#define SAT_RESTART_MIN         50
+#define SAT_RESTART_K           0.8
+#define SAT_RESTART_FAST        32
+#define SAT_RESTART_TRAIL       5000
+#define SAT_RESTART_BLOCK       10000
+#define SAT_RESTART_R           1.4
 #define SAT_RANDOM              1
+#define SAT_REDUCE_INIT         2000
+#define SAT_REDUCE_INC          300
+#define SAT_GLUE                2
+#define SAT_REPHASE             8
+#define SAT_ELIM_OCCS           16
+#define SAT_ELIM_LENGTH         20
+#define SAT_PROBE_LIMIT         100000
+#define SAT_ARENA_SIZE          GC_REGION_SIZE
+#define SAT_PAGESIZE            4096
+#define SAT_SHARE_LENGTH        8
+#define SAT_LOOK_CANDIDATES     64
 
 /*
  * Types.
@@ -47,24 +66,48 @@ typedef int level_t;
 
 typedef struct variable_s *variable_t;
 typedef struct clause_s *clause_t;
+typedef uint32_t clause_ref_t;
 typedef struct watch_s *watch_t;
+typedef struct binary_s *binary_t;
 
 /*
  * Watches.
  */
+struct watcher_s
+{
+    clause_ref_t clause;        // Watched clause.
+    literal_t blocker;          // Blocker literal (clause is TRUE if set).
+};
 struct watch_s
 {
     uint32_t size;              // Watch list size.
     uint32_t length;            // Watch list length.
-    clause_t clauses[];         // Watch list clauses.
+    struct watcher_s watchers[];
+                                // Watch list entries.
+};
+
+/*
+ * Binary clauses.  Binary clauses are not stored as clauses.  Instead, each
+ * literal has a list of literals that are implied if it becomes false.
+ */
+struct binary_s
+{
+    uint32_t size;              // Binary list size.
+    uint32_t length;            // Binary list length.
+    literal_t lits[];           // Implied literals.
 };
 
 /*
- * A clause.
+ * A clause.  Clauses are stored contiguously in the clause arena and are
+ * referenced by their 32-bit word offset (see sat_clause()).
  */
 struct clause_s
 {
     uint32_t length;            // Clause length, always >= 2
+    uint16_t lbd;               // Literal block distance (learnt only).
+    bool learnt;                // Is the clause learnt?
+    bool deleted;               // Is the clause deleted?
+    uint32_t activity;          // Clause activity (learnt only).
     literal_t lits[];           // Literals.  The two watch literals are
                                 // always lits[0] and lits[1].
 };
@@ -77,11 +120,23 @@ struct clause_s
 variable_t sat_vars;
 static size_t sat_vars_length;
 
+// Variable state.
+int8_t *sat_values;             // Literal values.
+level_t *sat_levels;            // Decision levels.
+static clause_ref_t *sat_reasons;
+                                // Reasons for non-decisions.
+static double *sat_activities;  // Activities.
+
 // State
 static bool sat_solving;        // Are we solving?
 static bool sat_empty;          // Was the empty clause asserted?
-static clause_t sat_reason;
+static bool sat_incremental_on; // Incremental mode?
+static clause_ref_t sat_reason;
 static literal_t sat_reason_0;
+static clause_ref_t sat_binary_conflict;
+                                // Binary clause conflict.
+static void *sat_action_env[5]; // Context of the last propagation.
+static action_t sat_action_result;
 
 // Trail.
 static level_t sat_tlevel;      // Trail level.
@@ -92,15 +147,114 @@ static literal_t *sat_trail;    // Trail.
 static choicepoint_t *sat_choices;
                                 // All (theory) choicepoints.
 
+// Clause arena.
+#define SAT_CLAUSE_NONE     0
+
+static uint32_t *sat_arena;     // Clause arena.
+static size_t sat_arena_len;    // Length of 'sat_arena' (in words).
+static size_t sat_arena_start;  // Start of the non-permanent clauses.
+static size_t sat_arena_wasted; // Words used by deleted clauses.
+struct reloc_s
+{
+    clause_ref_t from;          // Old clause offset.
+    clause_ref_t to;            // New clause offset.
+};
+static struct reloc_s *sat_relocs;
+                                // Relocations during compaction.
+static size_t sat_relocs_len;   // Length of 'sat_relocs'.
+
 // Clauses.
-static clause_t *sat_clauses;   // All clauses.
+static clause_ref_t *sat_clauses;
+                                // All (learnt) clauses.
 static size_t sat_clauses_len;  // Length of 'sat_clauses'.
 static ssize_t sat_next_clause; // Next clause.
 
+// Explanation clauses.  Non-`keep' lazy clauses form a separate tier that
+// can be deleted (when unlocked) by sat_reduce().
+static clause_ref_t *sat_explains;
+                                // All (non-keep) explanation clauses.
+static size_t sat_explains_len; // Length of 'sat_explains'.
+
+// Lazy clause table.  An open-addressing hash table of the lazy clauses,
+// keyed on the hash of the literal set.  Used to filter duplicate
+// explanations.  Binary clauses are stored with ref SAT_CLAUSE_NONE.
+#define SAT_LAZY_INIT       1024
+struct lazy_s
+{
+    uint64_t hash;              // Literal set hash (0 = empty).
+    clause_ref_t ref;           // Clause.
+    bool keep;                  // Is the clause a `keep' clause?
+};
+static struct lazy_s *sat_lazy; // Lazy clause table.
+static struct lazy_s *sat_lazy_spare;
+                                // Spare table (for rebuilding).
+static size_t sat_lazy_size;    // Size of 'sat_lazy' (power of 2).
+static size_t sat_lazy_len;     // Number of entries in 'sat_lazy'.
+
+// Deferred explanations.  A literal propagated by sat_lazy_propagate() has
+// the reason 'sat_deferred_reason' until the explanation is needed.
+struct deferred_s
+{
+    explain_t explain;          // Explanation callback.
+    literal_t lit;              // Propagated literal.
+    uint64_t data[SAT_EXPLAIN_SIZE / sizeof(uint64_t)];
+                                // Explanation payload.
+};
+static struct deferred_s *sat_deferred;
+                                // Per-variable deferred explanations.
+static clause_ref_t sat_deferred_reason;
+                                // Dummy reason for deferred literals.
+
+// LBD calculation.
+static uint32_t *sat_stamps;    // Decision level stamps.
+static uint32_t sat_stamp;      // Current stamp.
+
 // Order
-static index_t *sat_order;      // Variable order.
-static index_t sat_next_var;    // Next variable.
+#define SAT_HEAP_NONE       UINT32_MAX
+
+static index_t *sat_heap;       // Variable order (binary heap).
+static size_t sat_heap_len;     // Length of 'sat_heap'.
+static double sat_var_inc;      // Variable activity increment.
 static index_t sat_last_var;    // Last variable selected.
+static size_t sat_choice_next;  // Next choice to decide (sat_solve()).
+static level_t sat_choice_dlevel;
+                                // Level of the last choice decided.
+static literal_t *sat_core;     // Unsat core (failed choices).
+static size_t sat_core_len;     // Length of 'sat_core'.
+
+// Skipped variables.
+struct skip_s
+{
+    index_t idx;                // Skipped variable.
+    level_t dlevel;             // Decision level when skipped.
+};
+static struct skip_s *sat_skipped;
+                                // Skipped variables.
+static size_t sat_skipped_len;  // Length of 'sat_skipped'.
+
+// Conflict clause minimization.
+static literal_t *sat_minimize_stack;
+                                // Removable literal search stack.
+static literal_t *sat_minimize_clear;
+                                // Literals to clear after minimization.
+static size_t sat_minimize_clear_len;
+                                // Length of 'sat_minimize_clear'.
+
+// Eliminated clauses (for model reconstruction).
+static literal_t *sat_elim;     // Eliminated clauses.
+static size_t sat_elim_len;     // Length of 'sat_elim'.
+
+// Restarts.
+static size_t sat_restart_conflicts;
+                                // Conflicts since the last restart.
+static size_t sat_lbd_count;    // Number of learnt clause LBDs.
+static double sat_lbd_sum;      // Sum of learnt clause LBDs.
+static double sat_lbd_fast;     // Moving average of recent LBDs.
+static double sat_trail_avg;    // Moving average of conflict trail length.
+
+// Phases.
+static level_t sat_target_len;  // Trail length of the target phases.
+static level_t sat_best_len;    // Trail length of the best phases.
 
 // Random number generator.
 static uint32_t sat_z;
@@ -110,23 +264,61 @@ static uint32_t sat_w;
  * Prototypes.
  */
 static watch_t sat_watch_new(void);
-static void literal_addwatch(literal_t lit, clause_t clause);
+static void literal_addwatch(literal_t lit, clause_ref_t clause,
+    literal_t blocker);
 static void sat_watch_delete(watch_t watch, uint32_t idx);
-static literal_t sat_backtrack(clause_t reason, clause_t *learnt);
+static binary_t sat_binary_new(void);
+static void literal_addbinary(literal_t lit, literal_t implied);
+static literal_t sat_backtrack(clause_ref_t reason, clause_ref_t *learnt);
 static void sat_unwind(level_t tlevel, level_t blevel);
+static bool sat_is_removable(literal_t lit, uint32_t abstract);
 static void sat_bump_literal(literal_t lit);
 static void sat_bump_clause(clause_t clause);
 static void sat_decay(void);
+static void sat_heap_up(uint32_t pos);
+static void sat_heap_insert(index_t idx);
+static index_t sat_heap_pop(void);
+static void sat_unskip(level_t blevel);
+static uint32_t sat_lbd(literal_t *lits, size_t len);
+static void sat_reduce(void);
+static int sat_reduce_compare(const void *a, const void *b);
+static bool sat_clause_islocked(clause_ref_t clause);
+static void sat_compact(void);
+static void sat_arena_free(size_t from);
+static clause_ref_t sat_relocate(clause_ref_t clause);
 static literal_t sat_select_literal(literal_t *lits);
-static clause_t sat_init_clause(literal_t *lits, size_t litslen, bool learnt);
-static clause_t sat_new_clause(literal_t *lits, size_t litslen);
+static literal_t sat_select_choice(literal_t *choices, bool *failed);
+static void sat_analyze_core(literal_t lit);
+static void sat_save_phases(void);
+static bool sat_simplify(void);
+static bool sat_probe(void);
+static void sat_reconstruct(void);
+static void sat_rephase(void);
+static clause_ref_t sat_init_clause(literal_t *lits, size_t litslen,
+    bool learnt);
+static clause_ref_t sat_new_clause(literal_t *lits, size_t litslen,
+    bool learnt);
+static clause_ref_t sat_alloc_clause(literal_t *lits, size_t litslen,
+    bool learnt);
 static void sat_lazy_clause(literal_t *lits, size_t len, bool keep,
     const char *solver, size_t lineno);
-static clause_t sat_eager_clause(literal_t *lits, size_t len);
+static uint64_t sat_lazy_hash(literal_t lit);
+static bool sat_lazy_find(uint64_t hash, literal_t *lits, size_t len,
+    bool keep, clause_ref_t *ref);
+static void sat_lazy_insert(uint64_t hash, clause_ref_t ref, bool keep);
+static void sat_lazy_rebuild(size_t size);
+static void sat_lazy_rewatch(clause_ref_t ref, literal_t *lits);
+static clause_ref_t sat_get_reason(literal_t lit);
+static clause_ref_t sat_explain(literal_t lit);
+static clause_ref_t sat_eager_clause(literal_t *lits, size_t len);
 static bool sat_clause_istrue(literal_t *lits, size_t len);
-static action_t sat_action(action_t action) __attribute__ ((noinline))
-    __attribute__ ((optimize(2)));
+static action_t sat_action(action_t action) __attribute__ ((noinline));
 static size_t sat_luby(size_t i);
+static void sat_restart_update(uint32_t lbd);
+static bool sat_should_restart(void);
+static level_t sat_reuse_trail(void);
+static void sat_export(literal_t *lits, size_t len, uint32_t lbd);
+static bool sat_import(void);
 
 static char *sat_show_buf_literal(char *start, char *end, literal_t lit);
 static char *sat_show_literal(literal_t lit);
@@ -134,6 +326,7 @@ static char *sat_show_buf_lits(char *start, char *end, literal_t *lits,
     size_t len);
 static char *sat_show_lits(literal_t *lits, size_t litslen);
 static char *sat_show_clause(clause_t clause);
+static char *sat_show_reason(literal_t lit, clause_ref_t reason);
 
 /*
  * Simple functions.
@@ -166,6 +359,20 @@ static inline bool literal_getmark(literal_t lit)
     variable_t var = literal_getvar(lit);
     return var->mark;
 }
+static inline void literal_setpoison(literal_t lit, bool poison)
+{
+    variable_t var = literal_getvar(lit);
+    var->poison = poison;
+}
+static inline bool literal_getpoison(literal_t lit)
+{
+    variable_t var = literal_getvar(lit);
+    return var->poison;
+}
+static inline uint32_t sat_abstract_level(level_t dlevel)
+{
+    return ((uint32_t)1 << (dlevel & 31));
+}
 static inline void literal_setunit(literal_t lit)
 {
     variable_t var = literal_getvar(lit);
@@ -187,25 +394,91 @@ static inline void literal_setwatch(literal_t lit, watch_t watch)
     variable_t var = literal_getvar(lit);
     var->watches[literal_getsign(lit)] = watch;
 }
-static inline clause_t literal_getreason(literal_t lit)
+static inline binary_t literal_getbinary(literal_t lit)
 {
     variable_t var = literal_getvar(lit);
-    return var->reason;
+    return var->binaries[literal_getsign(lit)];
 }
-static inline void literal_setreason(literal_t lit, clause_t reason)
+static inline void literal_setbinary(literal_t lit, binary_t binary)
 {
     variable_t var = literal_getvar(lit);
-    var->reason = reason;
+    var->binaries[literal_getsign(lit)] = binary;
 }
-static inline uint32_t literal_getactivity(literal_t lit)
+static inline clause_ref_t literal_getreason(literal_t lit)
 {
-    variable_t var = literal_getvar(lit);
-    return var->activity;
+    index_t idx = literal_getindex(lit);
+    return sat_reasons[idx];
 }
-static inline uint32_t literal_getorder(literal_t lit)
+static inline void literal_setreason(literal_t lit, clause_ref_t reason)
 {
-    variable_t var = literal_getvar(lit);
-    return var->order;
+    index_t idx = literal_getindex(lit);
+    sat_reasons[idx] = reason;
+}
+static inline double literal_getactivity(literal_t lit)
+{
+    index_t idx = literal_getindex(lit);
+    return sat_activities[idx];
+}
+static inline bool sat_heap_contains(index_t idx)
+{
+    return (sat_vars[idx].order != SAT_HEAP_NONE);
+}
+static inline void literal_reorder(literal_t lit)
+{
+    index_t idx = literal_getindex(lit);
+    if (!sat_heap_contains(idx))
+        sat_heap_insert(idx);
+}
+
+/*
+ * Clause references.  Clauses are always allocated at even offsets.
+ */
+static inline clause_t sat_clause(clause_ref_t clause)
+{
+    return (clause_t)(sat_arena + clause);
+}
+static inline size_t sat_clause_size(size_t litslen)
+{
+    size_t size = (sizeof(struct clause_s) + litslen*sizeof(literal_t)) /
+        sizeof(uint32_t);
+    return (size + 1) & ~(size_t)0x1;
+}
+
+/*
+ * Binary clause reasons.  The reason for a literal implied by a binary clause
+ * is the other (false) literal, encoded as an odd (i.e. non-clause) value.
+ */
+static inline clause_ref_t sat_binary_reason(literal_t lit)
+{
+    return (((uint32_t)lit) << 1) | 0x1;
+}
+static inline bool sat_reason_isbinary(clause_ref_t reason)
+{
+    return (reason & 0x1) != 0;
+}
+static inline literal_t sat_reason_getbinary(clause_ref_t reason)
+{
+    return (literal_t)((int32_t)reason >> 1);
+}
+
+/*
+ * Get the literals of the reason for (implied) literal 'lit'.  The implied
+ * literal is always lits[0].  The buffer 'buf' must have room for two
+ * literals.
+ */
+static inline literal_t *sat_reason_lits(literal_t lit, clause_ref_t reason,
+    literal_t *buf, uint32_t *len)
+{
+    if (sat_reason_isbinary(reason))
+    {
+        buf[0] = lit;
+        buf[1] = sat_reason_getbinary(reason);
+        *len = 2;
+        return buf;
+    }
+    clause_t clause = sat_clause(reason);
+    *len = clause->length;
+    return clause->lits;
 }
 static inline void sat_setchoice(void)
 {
@@ -224,19 +497,22 @@ static inline choicepoint_t sat_getchoice(void)
 /*
  * Assert the literal.
  */
-static void literal_set(literal_t lit, clause_t reason)
+static void literal_set(literal_t lit, clause_ref_t reason)
 {
     debug("!ySET!d %s !yLEVEL!d %u !yREASON!d !g%s!d",
         sat_show_literal(lit), sat_dlevel,
-        (reason == NULL? "(decision)": sat_show_clause(reason)));
+        (reason == SAT_CLAUSE_NONE? "(decision)":
+            sat_show_reason(lit, reason)));
 
-    variable_t var = literal_getvar(lit);
-    var->sign = literal_getsign(lit);
-    var->set = true;
-    var->dlevel = sat_dlevel;
-    var->reason = reason;
+    index_t idx = literal_getindex(lit);
+    size_t code = literal_getcode(lit);
+    sat_values[code]     = 1;
+    sat_values[code ^ 1] = -1;
+    sat_levels[idx]  = sat_dlevel;
+    sat_reasons[idx] = reason;
     sat_trail[sat_tlevel] = lit;
     sat_tlevel++;
+    variable_t var = sat_vars + idx;
     if (var->cons != NULL)
     {
         solver_event_decision(var->cons);
@@ -251,20 +527,21 @@ static inline void literal_unset(literal_t lit)
 {
     debug("!yUNSET!d %s !yLEVEL!d %u !yREASON!d !g%s!d",
         sat_show_literal(lit), literal_getdlevel(lit),
-        (literal_getreason(lit) == NULL? "(decision)":
-            sat_show_clause(literal_getreason(lit))));
+        (literal_getreason(lit) == SAT_CLAUSE_NONE? "(decision)":
+            sat_show_reason(lit, literal_getreason(lit))));
     
     variable_t var = literal_getvar(lit);
-    var->set = false;
-    index_t order = var->order;
-    if (order < sat_next_var)
-        sat_next_var = order;
+    size_t code = 2*(size_t)literal_getindex(lit);
+    var->phase = (sat_values[code] < 0? SAT_NEG: SAT_POS);
+    sat_values[code]     = 0;
+    sat_values[code + 1] = 0;
+    literal_reorder(lit);
 }
 
 /*
  * Assign lit to be true; and propagate.
  */
-static bool sat_propagate(literal_t lit, clause_t reason)
+static bool sat_propagate(literal_t lit, clause_ref_t reason)
 {
     level_t curr, next;
 
@@ -284,10 +561,48 @@ sat_propagate_loop:
         curr++;
         debug("!rPROPAGATE!d %s", sat_show_literal(lit));
         lit = literal_negate(lit);
+
+        // Binary clauses:
+        binary_t binary = literal_getbinary(lit);
+        for (uint32_t i = 0; i < binary->length; i++)
+        {
+            literal_t implied = binary->lits[i];
+            if (literal_istrue(implied))
+                continue;
+            if (literal_isfree(implied))
+            {
+                debug("!rIMPLIED!d %s", sat_show_literal(implied));
+                if (option_debug_on)
+                {
+                    literal_t lits[2] = {implied, lit};
+                    debug_step(DEBUG_PROPAGATE, false, lits, 2, NULL, 0);
+                }
+                literal_set(implied, sat_binary_reason(lit));
+                next++;
+                continue;
+            }
+
+            // Both literals are false; fail.
+            clause_t conflict = sat_clause(sat_binary_conflict);
+            conflict->lits[0] = implied;
+            conflict->lits[1] = lit;
+            debug("!rCONFLICT!d %s", sat_show_clause(conflict));
+            debug_step(DEBUG_FAIL, false, conflict->lits, 2, NULL, 0);
+            solver_flush_queue();
+            lit = sat_backtrack(sat_binary_conflict, &reason);
+            if (lit == LITERAL_NIL)
+                return false;
+            goto sat_propagate_restart;
+        }
+
+        // Other clauses:
         watch_t watch = literal_getwatch(lit);
         for (int i = 0; i < watch->length; i++)
         {
-            clause_t clause = watch->clauses[i];
+            if (literal_istrue(watch->watchers[i].blocker))
+                continue;
+            clause_ref_t ref = watch->watchers[i].clause;
+            clause_t clause = sat_clause(ref);
             bool watch_lit_idx = (clause->lits[0] == lit);
             literal_t watch_lit = clause->lits[watch_lit_idx];
             
@@ -297,6 +612,7 @@ sat_propagate_loop:
             {
                 debug("!rTRUE!d %s", sat_show_clause(clause));
                 // Clause is TRUE.
+                watch->watchers[i].blocker = watch_lit;
                 continue;
             }
 
@@ -322,7 +638,7 @@ sat_propagate_loop:
                     }
                     debug_step(DEBUG_PROPAGATE, false, clause->lits,
                         clause->length, NULL, 0);
-                    literal_set(watch_lit, clause);
+                    literal_set(watch_lit, ref);
                     next++;
                     continue;
                 }
@@ -332,7 +648,7 @@ sat_propagate_loop:
                 debug_step(DEBUG_FAIL, false, clause->lits, clause->length,
                     NULL, 0);
                 solver_flush_queue();
-                lit = sat_backtrack(clause, &reason);
+                lit = sat_backtrack(ref, &reason);
                 if (lit == LITERAL_NIL)
                     return false;
                 goto sat_propagate_restart;
@@ -343,11 +659,10 @@ sat_propagate_loop:
             clause->lits[!watch_lit_idx] = new_watch_lit;
             clause->lits[j]              = lit;
             check(!literal_isfalse(new_watch_lit));
-            literal_addwatch(new_watch_lit, clause);
-            index_t order = literal_getorder(new_watch_lit);
+            literal_addwatch(new_watch_lit, ref, watch_lit);
             sat_watch_delete(watch, i);
-            if (order < sat_next_var)
-                sat_next_var = order;
+            if (literal_isfree(new_watch_lit))
+                literal_reorder(new_watch_lit);
             i--;
         }
     }
@@ -386,16 +701,30 @@ sat_propagate_loop:
     return true;
 }
 
+/*
+ * Resume "inside" the last call to sat_action(SAT_ACTION_PROPAGATE).
+ * NOTE: __builtin_longjmp() must not be called from the same function as the
+ *       corresponding __builtin_setjmp().
+ */
+static void __attribute__((__noinline__, __noreturn__)) sat_action_resume(
+    action_t action)
+{
+    sat_action_result = action;
+    __builtin_longjmp(sat_action_env, 1);
+}
+
 /*
  * SAT/Theory solver interface.
  */
 extern action_t sat_action(action_t action)
 {
     /*
-     * Note: this function does not work at optimization level 0 (-O0)
+     * Note: the FAIL/RESTART actions do not return to their caller; rather
+     *       control resumes "inside" the last call to
+     *       sat_action(SAT_ACTION_PROPAGATE).  The jump restores the
+     *       callee-saved registers, so this is safe at any optimization
+     *       level.
      */
-    static void *sp = NULL;
-
     switch (action)
     {
         case SAT_ACTION_PROPAGATE:
@@ -403,8 +732,13 @@ extern action_t sat_action(action_t action)
              * A SAT variable has been set, do solver propagation.
              */
 
-            // Save the stack-pointer.
-            asm ("movq %%rsp, %0": "=m"(sp));
+            // Save the context:
+            if (__builtin_setjmp(sat_action_env) != 0)
+            {
+                // We are now "inside" the last call to
+                // sat_action(SAT_ACTION_PROPAGATE)
+                return sat_action_result;
+            }
 
             // Propagate:
             solver_wake_prop();
@@ -413,33 +747,19 @@ extern action_t sat_action(action_t action)
             return SAT_ACTION_PROPAGATE;
 
         case SAT_ACTION_FAIL:
-            /*
-             * A solver has reported failure.
-             */
-
-            // Reset all propagators
-            solver_flush_queue();
- 
-            // Restore the stack-pointer.
-            asm ("movq %0, %%rsp": : "m"(sp));
-
-            // We are now "inside" the last call to
-            // sat_action(SAT_ACTION_PROPAGATE)
-
-            return SAT_ACTION_FAIL;
-
         case SAT_ACTION_RESTART:
             /*
-             * A solver has asserted a late clause.
+             * A solver has reported failure, or has asserted a late clause.
              */
 
             // Reset all propagators
+#ifdef PROPPROF
+            solver_profile_abort(action == SAT_ACTION_FAIL);
+#endif
             solver_flush_queue();
-            
-            // Restore the stack-pointer.
-            asm ("movq %0, %%rsp": : "m"(sp));
 
-            return SAT_ACTION_RESTART;
+            // Restore the context.
+            sat_action_resume(action);
     }
 
     return SAT_ACTION_PROPAGATE;
@@ -448,27 +768,30 @@ extern action_t sat_action(action_t action)
 /*
  * Backtrack+learning after failure.
  */
-static literal_t sat_backtrack(clause_t reason, clause_t *nogood_ptr)
+static literal_t sat_backtrack(clause_ref_t reason, clause_ref_t *nogood_ptr)
 {
     stat_backtracks++;
 
-    sat_bump_clause(reason);
+    check(reason != SAT_CLAUSE_NONE);
+    clause_t clause = sat_clause(reason);
+    sat_bump_clause(clause);
 
     literal_t conflicts[sat_tlevel];
     uint32_t conflicts_len = 0;
     literal_t lit;
 
-    check(reason != NULL);
-
     // We have failed at the top-level; no work to do.
     if (sat_dlevel == 0)
         return LITERAL_NIL;
 
+    if (option_phase == PHASE_TARGET)
+        sat_save_phases();
+
     // Mark literals in 'reason':
     uint32_t count = 0;
-    for (uint32_t i = 0; i < reason->length; i++)
+    for (uint32_t i = 0; i < clause->length; i++)
     {
-        lit = reason->lits[i];
+        lit = clause->lits[i];
         level_t dlevel = literal_getdlevel(lit);
     
         // Ignore unit literals
@@ -513,12 +836,27 @@ static literal_t sat_backtrack(clause_t reason, clause_t *nogood_ptr)
         count--;
         if (count <= 0)
             break;
-        reason = literal_getreason(lit);
-        check(reason != NULL);
-        sat_bump_clause(reason);
-        for (uint32_t i = 1; i < reason->length; i++)
+        reason = sat_get_reason(lit);
+        check(reason != SAT_CLAUSE_NONE);
+        literal_t buf[2];
+        uint32_t len;
+        literal_t *lits = sat_reason_lits(lit, reason, buf, &len);
+        if (sat_reason_isbinary(reason))
+            sat_bump_literal(lits[1]);
+        else
+        {
+            clause = sat_clause(reason);
+            sat_bump_clause(clause);
+            if (clause->learnt && clause->lbd > SAT_GLUE)
+            {
+                uint32_t lbd = sat_lbd(clause->lits, clause->length);
+                if (lbd < clause->lbd)
+                    clause->lbd = lbd;
+            }
+        }
+        for (uint32_t i = 1; i < len; i++)
         {
-            lit = reason->lits[i];
+            lit = lits[i];
             if (literal_getmark(lit))
             {
                 debug("!bMARKED!d %s", sat_show_literal(lit));
@@ -550,18 +888,18 @@ static literal_t sat_backtrack(clause_t reason, clause_t *nogood_ptr)
     uint32_t nogood_len = 0;
     level_t blevel = 0;
     nogood[nogood_len++] = literal_negate(lit);
+    uint32_t abstract = 0;
+    for (uint32_t i = 0; i < conflicts_len; i++)
+        abstract |= sat_abstract_level(literal_getdlevel(conflicts[i]));
+    sat_minimize_clear_len = 0;
     for (uint32_t i = 0; i < conflicts_len; i++)
     {
         lit = conflicts[i];
-        if (literal_getreason(lit) != NULL)   // !Decision
+        if (literal_getreason(lit) != SAT_CLAUSE_NONE &&   // !Decision
+                sat_is_removable(lit, abstract))
         {
-            reason = literal_getreason(lit);
-            uint32_t k;
-            for (k = 1; k < reason->length &&
-                    literal_getmark(reason->lits[k]); k++)
-                ;
-            if (k >= reason->length)
-                continue;
+            debug("!bREMOVABLE!d %s", sat_show_literal(lit));
+            continue;
         }
         nogood[nogood_len++] = lit;
         level_t dlevel = literal_getdlevel(lit);
@@ -573,6 +911,11 @@ static literal_t sat_backtrack(clause_t reason, clause_t *nogood_ptr)
         }
     }
 
+    uint32_t lbd = sat_lbd(nogood, nogood_len);
+    sat_restart_update(lbd);
+    if (portfolio_on && (nogood_len <= SAT_SHARE_LENGTH || lbd <= SAT_GLUE))
+        sat_export(nogood, nogood_len, lbd);
+
     // Unwind the trail:
     while (tlevel >= 0)
     {
@@ -583,20 +926,31 @@ static literal_t sat_backtrack(clause_t reason, clause_t *nogood_ptr)
         tlevel--;
     }
     sat_tlevel = tlevel+1;
+    sat_unskip(blevel);
 
     // Clear marks.
     for (uint32_t i = 0; i < conflicts_len; i++)
         literal_setmark(conflicts[i], false);
+    for (size_t i = 0; i < sat_minimize_clear_len; i++)
+    {
+        literal_setmark(sat_minimize_clear[i], false);
+        literal_setpoison(sat_minimize_clear[i], false);
+    }
+    stat_minimized_lits += conflicts_len + 1 - nogood_len;
 
     debug_step(DEBUG_LEARN, false, nogood, nogood_len, NULL, 0);
-    clause_t nogood_clause = sat_init_clause(nogood, nogood_len, true);
-    if (nogood_clause != NULL)
+    clause_ref_t nogood_clause = sat_init_clause(nogood, nogood_len, true);
+    if (nogood_clause != SAT_CLAUSE_NONE &&
+        !sat_reason_isbinary(nogood_clause))
     {
+        clause = sat_clause(nogood_clause);
+        clause->lbd = (lbd > UINT16_MAX? UINT16_MAX: lbd);
         sat_next_clause = sat_clauses_len;
         sat_clauses[sat_clauses_len++] = nogood_clause;
     }
     *nogood_ptr = nogood_clause;
     sat_dlevel = blevel;
+    sat_decay();
 
     if (sat_empty)
         return LITERAL_NIL;
@@ -608,6 +962,57 @@ static literal_t sat_backtrack(clause_t reason, clause_t *nogood_ptr)
     return nogood[0];
 }
 
+/*
+ * Test if a (marked) conflict literal is implied by the other marked
+ * literals, i.e. can be removed from the learnt clause.  Marked literals are
+ * either part of the clause or already known to be removable, and poisoned
+ * literals are known to be non-removable.  A literal whose decision level is
+ * not in 'abstract' cannot be removable.
+ */
+static bool sat_is_removable(literal_t lit, uint32_t abstract)
+{
+    size_t stack_len = 0, clear_len = sat_minimize_clear_len;
+    sat_minimize_stack[stack_len++] = lit;
+    while (stack_len > 0)
+    {
+        literal_t lit_0 = sat_minimize_stack[--stack_len];
+        clause_ref_t reason = sat_get_reason(lit_0);
+        literal_t buf[2];
+        uint32_t len;
+        literal_t *lits = sat_reason_lits(lit_0, reason, buf, &len);
+        for (uint32_t i = 1; i < len; i++)
+        {
+            literal_t lit_i = lits[i];
+            if (literal_getmark(lit_i))
+                continue;
+            level_t dlevel = literal_getdlevel(lit_i);
+            if (dlevel == 0)
+                continue;
+            if (!literal_getpoison(lit_i) &&
+                    literal_getreason(lit_i) != SAT_CLAUSE_NONE &&
+                    (sat_abstract_level(dlevel) & abstract) != 0)
+            {
+                literal_setmark(lit_i, true);
+                sat_minimize_stack[stack_len++] = lit_i;
+                sat_minimize_clear[sat_minimize_clear_len++] = lit_i;
+                continue;
+            }
+
+            // Not removable; undo the marks from this search:
+            for (size_t j = clear_len; j < sat_minimize_clear_len; j++)
+                literal_setmark(sat_minimize_clear[j], false);
+            sat_minimize_clear_len = clear_len;
+            if (!literal_getpoison(lit_i))
+            {
+                literal_setpoison(lit_i, true);
+                sat_minimize_clear[sat_minimize_clear_len++] = lit_i;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
 /*
  * Unwind the state to the given level.
  * TODO: use?
@@ -625,6 +1030,7 @@ static void sat_unwind(level_t tlevel, level_t blevel)
     }
     sat_tlevel = tlevel+1;
     sat_dlevel = blevel;
+    sat_unskip(blevel);
     solver_backtrack(sat_getchoice());
 }
 
@@ -654,35 +1060,191 @@ static size_t sat_luby(size_t i)
     }
 }
 
+/*
+ * Update the restart averages after a conflict with the given learnt clause
+ * LBD.  The current trail is the conflicting trail.
+ */
+static void sat_restart_update(uint32_t lbd)
+{
+    sat_restart_conflicts++;
+    sat_lbd_count++;
+    sat_lbd_sum += (double)lbd;
+    if (sat_lbd_count == 1)
+    {
+        sat_lbd_fast  = (double)lbd;
+        sat_trail_avg = (double)sat_tlevel;
+        return;
+    }
+    sat_lbd_fast += ((double)lbd - sat_lbd_fast) / SAT_RESTART_FAST;
+
+    // Block the restart if the trail is much larger than usual, i.e. the
+    // solver may be approaching a solution:
+    if (sat_lbd_count > SAT_RESTART_BLOCK &&
+            sat_restart_conflicts >= SAT_RESTART_MIN &&
+            (double)sat_tlevel > SAT_RESTART_R * sat_trail_avg)
+    {
+        debug("!cBLOCK RESTART!d [trail=%d, average=%g]", sat_tlevel,
+            sat_trail_avg);
+        sat_restart_conflicts = 0;
+    }
+    sat_trail_avg += ((double)sat_tlevel - sat_trail_avg) / SAT_RESTART_TRAIL;
+}
+
+/*
+ * Test if the search should restart, i.e. if the recent learnt clauses are
+ * worse (higher LBD) than average.
+ */
+static bool sat_should_restart(void)
+{
+    if (sat_restart_conflicts < SAT_RESTART_MIN)
+        return false;
+    return (sat_lbd_fast * SAT_RESTART_K > sat_lbd_sum / sat_lbd_count);
+}
+
+/*
+ * Find the decision level to restart to.  Decisions that are more active
+ * than the next decision variable would be immediately re-taken after a full
+ * restart, so these levels are kept.
+ */
+static level_t sat_reuse_trail(void)
+{
+    while (sat_heap_len > 0 && !literal_isfree(literal_makeindex(sat_heap[0])))
+        sat_heap_pop();
+    if (sat_heap_len == 0)
+        return 0;
+    double activity = sat_activities[sat_heap[0]];
+    level_t blevel = 0;
+    for (level_t i = 0; i < sat_tlevel; i++)
+    {
+        literal_t lit = sat_trail[i];
+        level_t dlevel = literal_getdlevel(lit);
+        if (dlevel == 0 || literal_getreason(lit) != SAT_CLAUSE_NONE)
+            continue;
+        if (literal_getactivity(lit) < activity)
+            break;
+        blevel = dlevel;
+    }
+    return blevel;
+}
+
 /*
  * Restart the search.
  */
 static void sat_restart(void)
 {
     debug("!cRESTART!d");
+    stat_restarts++;
+    sat_restart_conflicts = 0;
     if (sat_dlevel == 1)
         return;
+    level_t blevel = (portfolio_on && portfolio_pending()? 0:
+        sat_reuse_trail());
+    stat_reused_levels += blevel;
+    if (blevel+1 >= sat_dlevel)
+    {
+        // Every level is kept.  Note that sat_choices[blevel+1] is stale
+        // (from an earlier, deeper search), so must not be backtracked to.
+        return;
+    }
     level_t tlevel = sat_tlevel-1;
     while (tlevel >= 0)
     {
         literal_t lit = sat_trail[tlevel];
-        if (literal_getdlevel(lit) == 0)
+        if (literal_getdlevel(lit) <= blevel)
             break;
         literal_unset(lit);
         tlevel--;
     }
     assert(tlevel >= 0);
     sat_tlevel = tlevel+1;
-    sat_dlevel = 1;
-    solver_backtrack(sat_choices[1]);
+    sat_dlevel = blevel+1;
+    sat_unskip(blevel);
+    sat_target_len = 0;
+    solver_backtrack(sat_choices[blevel+1]);
+}
+
+/*
+ * Share a learnt clause with the other portfolio workers.  Only clauses
+ * over the original variables are shared, since lazily generated variables
+ * differ between workers.
+ */
+static void sat_export(literal_t *lits, size_t len, uint32_t lbd)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (literal_getvar(lits[i])->lazy)
+            return;
+    }
+    portfolio_export(lits, len, lbd);
+}
+
+/*
+ * Import the clauses shared by the other portfolio workers.  Clauses can
+ * only be imported after a full restart (dlevel == 1), where all literals
+ * are either free or set at level 0.  Returns false if the problem is UNSAT.
+ */
+static bool sat_import(void)
+{
+    if (sat_dlevel != 1)
+        return true;
+    literal_t lits[PORTFOLIO_CLAUSE_MAX];
+    uint32_t lbd;
+    size_t len;
+    while ((len = portfolio_import(lits, &lbd)) != 0)
+    {
+        size_t j = 0;
+        bool skip = false;
+        for (size_t i = 0; !skip && i < len; i++)
+        {
+            literal_t lit = lits[i];
+            if (literal_getindex(lit) >= (index_t)sat_vars_length ||
+                    literal_getvar(lit)->elim || literal_istrue(lit))
+                skip = true;
+            else if (!literal_isfalse(lit))
+                lits[j++] = lit;
+        }
+        if (skip)
+            continue;
+        debug("!yIMPORT!d %s", sat_show_lits(lits, j));
+        switch (j)
+        {
+            case 0:
+                sat_empty = true;
+                return false;
+            case 1:
+            {
+                sat_dlevel = 0;
+                bool ok = sat_propagate(lits[0], SAT_CLAUSE_NONE);
+                sat_dlevel = 1;
+                if (!ok)
+                    return false;
+                break;
+            }
+            default:
+            {
+                clause_ref_t ref = sat_init_clause(lits, j, true);
+                if (!sat_reason_isbinary(ref))
+                {
+                    sat_clause(ref)->lbd = (lbd > UINT16_MAX? UINT16_MAX: lbd);
+                    sat_clauses[sat_clauses_len++] = ref;
+                }
+                break;
+            }
+        }
+    }
+    return true;
 }
 
 /*
- * Perform a search.
+ * Perform a search.  The (LITERAL_NIL terminated) 'choices' are decided (in
+ * order) before any other decision, i.e. they are assumptions.  Returns false
+ * if the problem is UNSAT under the choices.
  */
 extern bool sat_solve(literal_t *choices)
 {
     sat_solving = true;
+    sat_core_len = 0;
+    size_t backtracks = stat_backtracks;
 
     // Empty clause?
     if (sat_empty)
@@ -695,40 +1257,74 @@ extern bool sat_solve(literal_t *choices)
         {
             literal_t lit = literal_makeindex((index_t)i);
             lit = (s? -lit: lit);
-            if (literal_isunit(lit))
+            if (literal_isunit(lit) && !literal_istrue(lit))
             {
+                // (In incremental mode, units from a previous search are
+                //  already set)
+                if (literal_isfalse(lit))
+                {
+                    sat_empty = true;
+                    return false;
+                }
                 debug_step(DEBUG_SELECT, false, &lit, 1, NULL, 0);
-                if (!sat_propagate(lit, NULL))
+                if (!sat_propagate(lit, SAT_CLAUSE_NONE))
                     return false;
             }
         }
     }
 
+    // Choices are never eliminated:
+    for (size_t i = 0; !literal_isnil(choices[i]); i++)
+        literal_getvar(choices[i])->frozen = true;
+
+    // Preprocessing (not in incremental mode, since later goals may refer to
+    // eliminated variables):
+    if (!sat_incremental_on && (!sat_simplify() || !sat_probe()))
+        return false;
+
     // Solving:
-    size_t next_decay = SAT_DECAY;
-    size_t next_restart = SAT_RESTART;
+    sat_choice_next = 0;
+    sat_choice_dlevel = 0;
+    size_t next_restart = backtracks + SAT_RESTART;
     size_t restart_seq = 1;
+    size_t next_reduce = backtracks + SAT_REDUCE_INIT;
+    stat_reduce_interval = SAT_REDUCE_INIT;
     for (sat_dlevel = 1; true; sat_dlevel++)
     {
-        if (stat_backtracks >= next_restart)
+        if (option_restart == RESTART_LUBY?
+                stat_backtracks >= next_restart: sat_should_restart())
         {
             sat_restart();
+            if (portfolio_on && !sat_import())
+                return false;
             restart_seq++;
+            if (option_phase == PHASE_TARGET && restart_seq % SAT_REPHASE == 0)
+                sat_rephase();
             next_restart += (SAT_RESTART * sat_luby(restart_seq));
         }
-        literal_t lit = sat_select_literal(choices);
+        if (stat_backtracks >= next_reduce)
+        {
+            sat_reduce();
+            stat_reduce_interval += SAT_REDUCE_INC;
+            next_reduce = stat_backtracks + stat_reduce_interval;
+        }
+        bool failed = false;
+        literal_t lit = sat_select_choice(choices, &failed);
+        if (failed)
+        {
+            // UNSAT under the choices
+            return false;
+        }
+        if (lit == LITERAL_NIL)
+            lit = sat_select_literal(choices);
         if (lit == LITERAL_NIL)
         {
             // All variables have been set; and no conflict; SAT
+            sat_reconstruct();
             return true;
         }
         debug_step(DEBUG_SELECT, false, &lit, 1, NULL, 0);
-        if (stat_backtracks >= next_decay)
-        {
-            next_decay += SAT_DECAY;
-            sat_decay();
-        }
-        if (!sat_propagate(lit, NULL))
+        if (!sat_propagate(lit, SAT_CLAUSE_NONE))
         {
             // UNSAT
             return false;
@@ -746,18 +1342,68 @@ extern void sat_init(void)
     // SAT solver memory:
     size_t size = 0x3FFFFFFF;
     sat_vars = (variable_t)buffer_alloc(size);
-    if (!gc_dynamic_root((void **)&sat_vars, &sat_vars_length,
-            sizeof(struct variable_s)))
+    if (!gc_typed_root((void **)&sat_vars, &sat_vars_length,
+            sizeof(struct variable_s),
+            gc_layout(struct variable_s, watches) |
+            gc_layout(struct variable_s, binaries) |
+            gc_layout(struct variable_s, cons) |
+            gc_layout(struct variable_s, name) |
+            gc_layout(struct variable_s, var)))
         panic("failed to set GC dynamic root for SAT variables: %s",
             strerror(errno));
     size = 0x3FFFFFFF;
+    sat_values = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_levels = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_reasons = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_activities = buffer_alloc(size);
+    size = 0x3FFFFFFF;
     sat_trail = buffer_alloc(size);
     size = 0x3FFFFFFF;
     sat_choices = buffer_alloc(size);
     size = 0x3FFFFFFF;
-    sat_order = buffer_alloc(size);
+    sat_heap = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_skipped = buffer_alloc(size);
     size = 0x3FFFFFFF;
     sat_clauses = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_stamps = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_elim = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_minimize_stack = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_minimize_clear = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_relocs = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_core = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_explains = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_lazy = buffer_alloc(size);
+    size = 0x3FFFFFFF;
+    sat_lazy_spare = buffer_alloc(size);
+    sat_lazy_size = SAT_LAZY_INIT;
+    size = 0x3FFFFFFF;
+    sat_deferred = buffer_alloc(size);
+    if (!gc_typed_root((void **)&sat_deferred, &sat_vars_length,
+            sizeof(struct deferred_s), gc_layout(struct deferred_s, data)))
+        panic("failed to set GC dynamic root for deferred explanations: "
+            "%s", strerror(errno));
+
+    // The clause arena.  Clauses contain no GC pointers, so the arena is
+    // not a GC root.  Offset 0 is reserved for SAT_CLAUSE_NONE.
+    size = SAT_ARENA_SIZE;
+    sat_arena = buffer_alloc(size);
+    sat_arena_len = 2;
+    literal_t lits[2] = {LITERAL_TRUE, LITERAL_TRUE};
+    sat_binary_conflict = sat_alloc_clause(lits, 2, false);
+    sat_deferred_reason = sat_alloc_clause(lits, 2, false);
+    sat_arena_start = sat_arena_len;
     sat_reset();
     return;
 }
@@ -772,13 +1418,32 @@ extern void sat_reset(void)
     sat_dlevel      = 0;
     sat_tlevel      = 0;
     sat_empty       = false;
-    sat_reason      = NULL;
+    sat_incremental_on = false;
+    sat_core_len    = 0;
+    sat_reason      = SAT_CLAUSE_NONE;
     sat_z           = 0xDEADBEEF;
     sat_w           = 0x12345678;
-    sat_next_var    = 0;
+    sat_heap_len    = 0;
+    sat_var_inc     = 1.0;
+    sat_skipped_len = 0;
     sat_last_var    = -1;
     sat_clauses_len = 0;
     sat_next_clause = -1;
+    sat_explains_len = 0;
+    memset(sat_lazy, 0, sat_lazy_size*sizeof(struct lazy_s));
+    sat_lazy_len    = 0;
+    sat_arena_free(sat_arena_start);
+    sat_arena_len   = sat_arena_start;
+    sat_arena_wasted = 0;
+    sat_stamp       = 0;
+    sat_target_len  = 0;
+    sat_best_len    = 0;
+    sat_elim_len    = 0;
+    sat_restart_conflicts = 0;
+    sat_lbd_count   = 0;
+    sat_lbd_sum     = 0.0;
+    sat_lbd_fast    = 0.0;
+    sat_trail_avg   = 0.0;
 
     // Variable 0 is always set.
     bvar_t b0 = sat_make_var(make_var("__TRUE__"), NULL);
@@ -786,51 +1451,126 @@ extern void sat_reset(void)
     sat_init_clause(&b0, 1, false);
 }
 
-/****************************************************************************/
-/* VARIABLES                                                                */
-/****************************************************************************/
-
 /*
- * Create a new SAT variable.
+ * Seed the random number generator and perturb the initial variable order
+ * (used to diversify portfolio workers).  Must be called before solving.
  */
-extern bvar_t sat_make_var(var_t v, cons_t c)
+extern void sat_seed(uint32_t seed)
 {
-    index_t idx = sat_vars_length;
-    sat_vars_length++;
-    if (v == NULL)
+    sat_z ^= seed * 0x9E3779B9;
+    sat_w += seed;
+    for (size_t i = 1; i < sat_vars_length; i++)
     {
-        size_t size = 16;
-        char *name = gc_malloc(size);
-        snprintf(name, size, "_SAT_%zu", sat_vars_length);
-        v = make_var(name);
+        sat_activities[i] = (double)(sat_rand() % 1024) / 1048576.0;
+        if (sat_heap_contains((index_t)i))
+            sat_heap_up(sat_vars[i].order);
     }
-    variable_t var = (variable_t)(sat_vars + idx);
-    var->set       = false;
-    var->sign      = false;
-    var->mark      = false;
-    var->unit      = false;
-    var->unit_sign = false;
-    var->lazy      = sat_solving;
-    var->dlevel = 0;
-    var->reason = NULL;
-    var->activity = 0;
-    var->order = idx;
-    var->watches[0] = sat_watch_new();
-    var->watches[1] = sat_watch_new();
-    var->var        = v;
-    var->cons = c;
-    sat_order[idx] = idx;
-    return literal_makeindex(idx);
 }
 
 /*
- * Get the term var of a SAT variable.
+ * Store the current assignment of the original (non-lazy) variables in
+ * 'model', and return the number of literals stored.
  */
-extern var_t sat_get_var(bvar_t b)
+extern size_t sat_get_model(literal_t *model)
 {
-    index_t idx = literal_getindex(b);
-    variable_t var = sat_vars + idx;
-    return var->var;
+    size_t len = 0;
+    for (size_t i = 1; i < sat_vars_length; i++)
+    {
+        literal_t lit = literal_makeindex((index_t)i);
+        if (sat_vars[i].lazy || literal_isfree(lit))
+            continue;
+        model[len++] = (literal_istrue(lit)? lit: literal_negate(lit));
+    }
+    return len;
+}
+
+/*
+ * Enable incremental mode.  Preprocessing is disabled, and the solver may be
+ * rewound (see sat_rewind()) and re-used for another search.  Must be called
+ * before solving.
+ */
+extern void sat_incremental(void)
+{
+    sat_incremental_on = true;
+}
+
+/*
+ * Backtrack to level 0 after a search (incremental mode).  Learnt clauses,
+ * lazily generated clauses and the level 0 state are kept, so new clauses can
+ * be added and sat_solve() called again.
+ */
+extern void sat_rewind(void)
+{
+    if (sat_tlevel > 0 && literal_getdlevel(sat_trail[sat_tlevel-1]) > 0)
+        sat_unwind(sat_tlevel-1, 0);
+    sat_dlevel  = 0;
+    sat_solving = false;
+}
+
+/*
+ * Store the unsat core of the last sat_solve() in 'core', and return its
+ * length.  The core is the subset of the choices responsible for the final
+ * conflict, and is empty if the problem is UNSAT without any choices.
+ */
+extern size_t sat_get_core(literal_t *core)
+{
+    memcpy(core, sat_core, sat_core_len * sizeof(literal_t));
+    return sat_core_len;
+}
+
+/****************************************************************************/
+/* VARIABLES                                                                */
+/****************************************************************************/
+
+/*
+ * Create a new SAT variable.
+ */
+extern bvar_t sat_make_var(var_t v, cons_t c)
+{
+    index_t idx = sat_vars_length;
+    sat_vars_length++;
+    if (v == NULL)
+    {
+        size_t size = 16;
+        char *name = gc_malloc(size);
+        snprintf(name, size, "_SAT_%zu", sat_vars_length);
+        v = make_var(name);
+    }
+    variable_t var = (variable_t)(sat_vars + idx);
+    var->mark      = false;
+    var->poison    = false;
+    var->elim      = false;
+    var->unit      = false;
+    var->unit_sign = false;
+    var->lazy      = sat_solving;
+    var->frozen    = false;
+    var->phase     = SAT_UNSET;
+    var->target    = SAT_UNSET;
+    var->best      = SAT_UNSET;
+    var->order = SAT_HEAP_NONE;
+    sat_values[2*(size_t)idx]   = 0;
+    sat_values[2*(size_t)idx+1] = 0;
+    sat_levels[idx]     = 0;
+    sat_reasons[idx]    = SAT_CLAUSE_NONE;
+    sat_activities[idx] = 0.0;
+    var->watches[0] = sat_watch_new();
+    var->watches[1] = sat_watch_new();
+    var->binaries[0] = sat_binary_new();
+    var->binaries[1] = sat_binary_new();
+    var->var        = v;
+    var->cons = c;
+    sat_heap_insert(idx);
+    return literal_makeindex(idx);
+}
+
+/*
+ * Get the term var of a SAT variable.
+ */
+extern var_t sat_get_var(bvar_t b)
+{
+    index_t idx = literal_getindex(b);
+    variable_t var = sat_vars + idx;
+    return var->var;
 }
 
 /*
@@ -848,108 +1588,449 @@ extern cons_t sat_get_constraint(bvar_t b)
 /****************************************************************************/
 
 /*
- * Bump the activity of a literal.
+ * Variable order: a binary heap of variables ordered by activity.
  */
-static void sat_bump_literal(literal_t lit)
+static inline bool sat_heap_lt(index_t a, index_t b)
 {
-    index_t idx = literal_getindex(lit);
-    variable_t var = sat_vars + idx;
-    var->activity++;
-    index_t order = var->order;
-    if (order == 0)
-        return;
-    variable_t var0 = sat_vars + sat_order[order-1];
-    if (var0->activity >= var->activity)
-        return;
-    var0 = sat_vars + sat_order[0];
-    index_t hi;
-    if (var0->activity + 1 == var->activity)
+    // Ties are broken by creation order:
+    double act_a = sat_activities[a], act_b = sat_activities[b];
+    return (act_a > act_b || (act_a == act_b && a < b));
+}
+static void sat_heap_up(uint32_t pos)
+{
+    index_t idx = sat_heap[pos];
+    while (pos > 0)
     {
-        hi = 0;
-        goto sat_bump_literal_swap;
+        uint32_t parent = (pos - 1) / 2;
+        index_t idx0 = sat_heap[parent];
+        if (!sat_heap_lt(idx, idx0))
+            break;
+        sat_heap[pos] = idx0;
+        sat_vars[idx0].order = pos;
+        pos = parent;
     }
-    index_t lo = 0;
-    hi = order-1;
-    while (hi - lo > 1)
+    sat_heap[pos] = idx;
+    sat_vars[idx].order = pos;
+}
+static void sat_heap_down(uint32_t pos)
+{
+    index_t idx = sat_heap[pos];
+    while (true)
     {
-        index_t mid = (lo + hi) / 2;
-        var0 = sat_vars + sat_order[mid];
-        if (var0->activity < var->activity)
-            hi = mid;
-        else
-            lo = mid;
+        uint32_t child = 2 * pos + 1;
+        if (child >= sat_heap_len)
+            break;
+        if (child + 1 < sat_heap_len &&
+                sat_heap_lt(sat_heap[child + 1], sat_heap[child]))
+            child++;
+        index_t idx0 = sat_heap[child];
+        if (!sat_heap_lt(idx0, idx))
+            break;
+        sat_heap[pos] = idx0;
+        sat_vars[idx0].order = pos;
+        pos = child;
+    }
+    sat_heap[pos] = idx;
+    sat_vars[idx].order = pos;
+}
+static void sat_heap_insert(index_t idx)
+{
+    uint32_t pos = sat_heap_len++;
+    sat_heap[pos] = idx;
+    sat_vars[idx].order = pos;
+    sat_heap_up(pos);
+}
+static index_t sat_heap_pop(void)
+{
+    index_t idx = sat_heap[0];
+    sat_vars[idx].order = SAT_HEAP_NONE;
+    sat_heap_len--;
+    if (sat_heap_len > 0)
+    {
+        sat_heap[0] = sat_heap[sat_heap_len];
+        sat_heap_down(0);
     }
+    return idx;
+}
+
+/*
+ * Re-insert variables that were skipped by sat_select_literal() after
+ * backtracking to level 'blevel'.  A variable is skipped because all of its
+ * clauses are TRUE, which may no longer hold after backtracking.
+ */
+static void sat_unskip(level_t blevel)
+{
+    while (sat_skipped_len > 0 &&
+            sat_skipped[sat_skipped_len-1].dlevel > blevel + 1)
+    {
+        sat_skipped_len--;
+        index_t idx = sat_skipped[sat_skipped_len].idx;
+        if (!sat_heap_contains(idx))
+            sat_heap_insert(idx);
+    }
+}
 
-sat_bump_literal_swap:
-    var0 = sat_vars + sat_order[hi];
-    index_t tmp = sat_order[hi];
-    sat_order[hi] = sat_order[order];
-    sat_order[order] = tmp;
-    var0->order = order;
-    var->order  = hi;
-    if (hi < sat_next_var)
-        sat_next_var = hi;
+/*
+ * Bump the activity of a literal.
+ */
+static void sat_bump_literal(literal_t lit)
+{
+    index_t idx = literal_getindex(lit);
+    sat_activities[idx] += sat_var_inc;
+    if (sat_activities[idx] > SAT_VAR_RESCALE)
+    {
+        // Rescale all activities:
+        for (size_t i = 0; i < sat_vars_length; i++)
+            sat_activities[i] *= 1.0 / SAT_VAR_RESCALE;
+        sat_var_inc *= 1.0 / SAT_VAR_RESCALE;
+    }
+    if (sat_heap_contains(idx))
+        sat_heap_up(sat_vars[idx].order);
 }
 
 /*
- * Bump the acitivity of a clause.
+ * Bump the acitivity of a clause.  The activity is only used for learnt and
+ * explanation clauses.
  */
 static void sat_bump_clause(clause_t clause)
 {
+    clause->activity++;
     for (size_t i = 0; i < clause->length; i++)
     {
         literal_t lit = clause->lits[i];
         sat_bump_literal(lit);
     }
+}
 
 /*
-    for (index_t i = 1; i < sat_vars_length; i++)
+ * Decay all activities.  Rather than scaling every activity down, the
+ * increment is scaled up (EVSIDS).
+ */
+static void sat_decay(void)
+{
+    sat_var_inc *= 1.0 / SAT_VAR_DECAY;
+}
+
+/*
+ * Compute the literal block distance (LBD) of a clause, i.e. the number of
+ * distinct decision levels.  All literals are assumed to be set.
+ */
+static uint32_t sat_lbd(literal_t *lits, size_t len)
+{
+    sat_stamp++;
+    if (sat_stamp == 0)
+    {
+        memset(sat_stamps, 0, (sat_vars_length+1)*sizeof(uint32_t));
+        sat_stamp = 1;
+    }
+    uint32_t lbd = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        level_t dlevel = literal_getdlevel(lits[i]);
+        if (sat_stamps[dlevel] != sat_stamp)
+        {
+            sat_stamps[dlevel] = sat_stamp;
+            lbd++;
+        }
+    }
+    return lbd;
+}
+
+/*
+ * Test if a clause is the reason for a currently set literal.  Such clauses
+ * cannot be deleted.
+ */
+static bool sat_clause_islocked(clause_ref_t clause)
+{
+    literal_t lit = sat_clause(clause)->lits[0];
+    return literal_istrue(lit) && literal_getreason(lit) == clause;
+}
+
+/*
+ * Learnt clause order for reduction: worst clauses (high LBD, low activity)
+ * first.
+ */
+static int sat_reduce_compare(const void *a, const void *b)
+{
+    clause_t ca = sat_clause(*(clause_ref_t *)a);
+    clause_t cb = sat_clause(*(clause_ref_t *)b);
+    if (ca->lbd != cb->lbd)
+        return (ca->lbd > cb->lbd? -1: 1);
+    if (ca->activity != cb->activity)
+        return (ca->activity < cb->activity? -1: 1);
+    return 0;
+}
+
+/*
+ * Reduce the learnt clause database.  Glue clauses (LBD <= SAT_GLUE) and
+ * locked clauses are always kept.  Of the remaining clauses, the worst half
+ * is deleted.  Unlocked explanation clauses that were not used since the
+ * last reduction are also deleted.
+ */
+static void sat_reduce(void)
+{
+    stat_reductions++;
+    qsort(sat_clauses, sat_clauses_len, sizeof(clause_ref_t),
+        sat_reduce_compare);
+
+    size_t count = 0;
+    for (size_t i = 0; i < sat_clauses_len; i++)
+    {
+        clause_t clause = sat_clause(sat_clauses[i]);
+        if (clause->lbd > SAT_GLUE && !sat_clause_islocked(sat_clauses[i]))
+            count++;
+    }
+    count /= 2;
+    for (size_t i = 0; count > 0 && i < sat_clauses_len; i++)
+    {
+        clause_t clause = sat_clause(sat_clauses[i]);
+        if (clause->lbd > SAT_GLUE && !sat_clause_islocked(sat_clauses[i]))
+        {
+            clause->deleted = true;
+            count--;
+        }
+    }
+
+    // Explanation clauses not used in any conflict since the last reduction
+    // can be re-derived by the theory solvers, so are deleted:
+    size_t k = 0;
+    for (size_t i = 0; i < sat_explains_len; i++)
+    {
+        clause_t clause = sat_clause(sat_explains[i]);
+        if (clause->deleted)
+            continue;
+        if (clause->activity == 0 && !sat_clause_islocked(sat_explains[i]))
+        {
+            debug("!rDELETE!d %s", sat_show_clause(clause));
+            clause->deleted = true;
+            sat_arena_wasted += sat_clause_size(clause->length);
+            stat_deleted_explanations++;
+            continue;
+        }
+        clause->activity >>= 1;
+        sat_explains[k++] = sat_explains[i];
+    }
+    sat_explains_len = k;
+
+    // Remove deleted clauses from all watch lists:
+    for (size_t i = 0; i < sat_vars_length; i++)
     {
-        literal_t lit_i = literal_makeindex(sat_order[i]);
-        literal_t lit_0 = literal_makeindex(sat_order[i-1]);
-        variable_t var_i = literal_getvar(lit_i);
-        variable_t var_0 = literal_getvar(lit_0);
-        check(var_i->activity <= var_0->activity);
-        if (literal_isfree(lit_i) && var_i->order < sat_next_var)
+        variable_t var = sat_vars + i;
+        for (size_t s = 0; s < 2; s++)
         {
-            for (size_t s = 0; s < 2; s++)
+            watch_t watch = var->watches[s];
+            uint32_t k = 0;
+            for (uint32_t j = 0; j < watch->length; j++)
             {
-                watch_t watch = var_i->watches[s];
-                for (size_t i = 0; i < watch->length; i++)
-                {
-                    clause_t clause = watch->clauses[i];
-                    bool found = false;
-                    for (size_t j = 0; j < clause->length; j++)
-                    {
-                        literal_t lit = clause->lits[j];
-                        if (literal_istrue(lit))
-                        {
-                            found = true;
-                            break;
-                        }
-                    }
-                    if (!found)
-                        panic("sat_next_var invariant broken; "
-                            "sat_next_var=%u, and the order of %s is %u",
-                            sat_next_var, sat_show_literal(lit_i),
-                            var_i->order);
-                }
+                clause_t clause = sat_clause(watch->watchers[j].clause);
+                if (!clause->deleted)
+                    watch->watchers[k++] = watch->watchers[j];
             }
+            watch->length = k;
+        }
+    }
+
+    // Free deleted clauses:
+    k = 0;
+    for (size_t i = 0; i < sat_clauses_len; i++)
+    {
+        clause_t clause = sat_clause(sat_clauses[i]);
+        if (clause->deleted)
+        {
+            debug("!rDELETE!d %s", sat_show_clause(clause));
+            sat_arena_wasted += sat_clause_size(clause->length);
+            continue;
         }
+        clause->activity >>= 1;
+        sat_clauses[k++] = sat_clauses[i];
     }
-*/
+    sat_clauses_len = k;
+    sat_next_clause = (ssize_t)k - 1;
+    stat_kept_clauses = k;
+
+    if (2*sat_arena_wasted > sat_arena_len - sat_arena_start)
+        sat_compact();
 }
 
 /*
- * Decay all activities.
+ * Compact the clause arena by sliding the live clauses over the deleted
+ * ones.  Clause references in the watch lists, reasons and 'sat_clauses' are
+ * updated in-place, so the propagation order is unchanged.
  */
-static void sat_decay(void)
+static void sat_compact(void)
 {
-    for (index_t i = 0; i < sat_vars_length; i++)
+    stat_compactions++;
+    sat_lazy_rebuild(sat_lazy_size);
+
+    // Compute the relocations:
+    sat_relocs_len = 0;
+    size_t to = sat_arena_start;
+    for (size_t from = sat_arena_start; from < sat_arena_len; )
+    {
+        clause_t clause = sat_clause(from);
+        size_t size = sat_clause_size(clause->length);
+        if (!clause->deleted)
+        {
+            sat_relocs[sat_relocs_len].from = (clause_ref_t)from;
+            sat_relocs[sat_relocs_len].to   = (clause_ref_t)to;
+            sat_relocs_len++;
+            to += size;
+        }
+        from += size;
+    }
+
+    // Update the references:
+    for (size_t i = 0; i < sat_vars_length; i++)
+    {
+        variable_t var = sat_vars + i;
+        for (size_t s = 0; s < 2; s++)
+        {
+            watch_t watch = var->watches[s];
+            for (uint32_t j = 0; j < watch->length; j++)
+                watch->watchers[j].clause =
+                    sat_relocate(watch->watchers[j].clause);
+        }
+        clause_ref_t reason = sat_reasons[i];
+        if (sat_values[2*i] != 0 && reason != SAT_CLAUSE_NONE &&
+                !sat_reason_isbinary(reason))
+        {
+            sat_reasons[i] = sat_relocate(reason);
+            check(sat_reasons[i] != SAT_CLAUSE_NONE || sat_levels[i] == 0);
+        }
+    }
+    for (size_t i = 0; i < sat_clauses_len; i++)
+        sat_clauses[i] = sat_relocate(sat_clauses[i]);
+    size_t k = 0;
+    for (size_t i = 0; i < sat_explains_len; i++)
+    {
+        clause_ref_t ref = sat_relocate(sat_explains[i]);
+        if (ref != SAT_CLAUSE_NONE)
+            sat_explains[k++] = ref;
+    }
+    sat_explains_len = k;
+    for (size_t i = 0; i < sat_lazy_size; i++)
+    {
+        if (sat_lazy[i].hash != 0 && sat_lazy[i].ref != SAT_CLAUSE_NONE)
+            sat_lazy[i].ref = sat_relocate(sat_lazy[i].ref);
+    }
+
+    // Move the clauses:
+    for (size_t i = 0; i < sat_relocs_len; i++)
+    {
+        clause_t clause = sat_clause(sat_relocs[i].from);
+        size_t size = sat_clause_size(clause->length);
+        memmove(sat_arena + sat_relocs[i].to, clause,
+            size*sizeof(uint32_t));
+    }
+    sat_arena_free(to);
+    sat_arena_len = to;
+    sat_arena_wasted = 0;
+}
+
+/*
+ * Release the (whole) pages of the clause arena after offset 'from'.
+ */
+static void sat_arena_free(size_t from)
+{
+    uintptr_t start = (uintptr_t)(sat_arena + from);
+    uintptr_t end = (uintptr_t)(sat_arena + sat_arena_len);
+    start = (start + SAT_PAGESIZE - 1) & ~(uintptr_t)(SAT_PAGESIZE - 1);
+    if (start < end)
+        buffer_free((void *)start, end - start);
+}
+
+/*
+ * Find the new offset of a clause during compaction.  Deleted clauses become
+ * SAT_CLAUSE_NONE.
+ */
+static clause_ref_t sat_relocate(clause_ref_t clause)
+{
+    if (clause < sat_arena_start)
+        return clause;
+    size_t lo = 0, hi = sat_relocs_len;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (sat_relocs[mid].from < clause)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < sat_relocs_len && sat_relocs[lo].from == clause)
+        return sat_relocs[lo].to;
+    return SAT_CLAUSE_NONE;
+}
+
+/*
+ * Save the current assignment as the target (and best) phases if it is the
+ * longest seen since the last restart (resp. rephase).
+ */
+static void sat_save_phases(void)
+{
+    if (sat_tlevel <= sat_target_len)
+        return;
+    sat_target_len = sat_tlevel;
+    bool best = (sat_tlevel > sat_best_len);
+    if (best)
+        sat_best_len = sat_tlevel;
+    for (level_t i = 0; i < sat_tlevel; i++)
+    {
+        literal_t lit = sat_trail[i];
+        variable_t var = literal_getvar(lit);
+        decision_t phase = (literal_getsign(lit)? SAT_NEG: SAT_POS);
+        var->target = phase;
+        if (best)
+            var->best = phase;
+    }
+}
+
+/*
+ * Reset the saved phases to the best phases.
+ */
+static void sat_rephase(void)
+{
+    debug("!cREPHASE!d [best=%d]", sat_best_len);
+    for (size_t i = 0; i < sat_vars_length; i++)
     {
         variable_t var = sat_vars + i;
-        var->activity >>= 1;
+        if (var->best != SAT_UNSET)
+            var->phase = var->best;
+        var->target = SAT_UNSET;
+    }
+    sat_best_len = 0;
+}
+
+/*
+ * Test if setting a variable with the given sign would satisfy some (watched)
+ * clause that is not already TRUE.
+ */
+static bool sat_is_relevant(variable_t var, int sign)
+{
+    binary_t binary = var->binaries[sign];
+    for (size_t i = 0; i < binary->length; i++)
+    {
+        if (!literal_istrue(binary->lits[i]))
+            return true;
+    }
+    watch_t watch = var->watches[sign];
+    for (size_t i = 0; i < watch->length; i++)
+    {
+        if (literal_istrue(watch->watchers[i].blocker))
+            continue;
+        clause_t clause = sat_clause(watch->watchers[i].clause);
+        bool found = false;
+        for (size_t j = 0; j < clause->length; j++)
+        {
+            if (literal_istrue(clause->lits[j]))
+            {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            return true;
     }
+    return false;
 }
 
 /*
@@ -959,20 +2040,43 @@ static literal_t sat_should_select_literal(literal_t lit)
 {
     if (lit == LITERAL_NIL)
         return LITERAL_NIL;
+    if (!literal_isfree(lit))
+        return LITERAL_NIL;
     variable_t var = literal_getvar(lit);
-    if (var->set)
+
+    // Phase saving:
+    decision_t phase = var->phase;
+    if (option_phase == PHASE_TARGET && var->target != SAT_UNSET)
+        phase = var->target;
+    if (option_phase != PHASE_SCORE && phase != SAT_UNSET)
+    {
+        // Prefer the saved phase unless it satisfies nothing new:
+        int sign = (phase == SAT_NEG);
+        if (sat_is_relevant(var, sign))
+            return (sign? -lit: lit);
+        if (sat_is_relevant(var, !sign))
+            return (sign? lit: -lit);
+        debug("!cSKIP!d %s", sat_show_literal(lit));
         return LITERAL_NIL;
+    }
 
+    // Score (also used for variables without a saved phase):
     int best_sign = -1, best_score = -1;
     for (int sign = 0; sign <= 1; sign++)
     {
-        watch_t watch = var->watches[sign];
+        binary_t binary = var->binaries[sign];
         int score = 0;
+        for (size_t i = 0; i < binary->length; i++)
+        {
+            if (!literal_istrue(binary->lits[i]))
+                score++;
+        }
+        watch_t watch = var->watches[sign];
         for (size_t i = 0; i < watch->length; i++)
         {
             // if (score > 8)
             //     break;
-            clause_t clause = watch->clauses[i];
+            clause_t clause = sat_clause(watch->watchers[i].clause);
             bool found = false;
             for (size_t j = 0; j < clause->length; j++)
             {
@@ -1003,35 +2107,112 @@ static literal_t sat_should_select_literal(literal_t lit)
 }
 
 /*
- * Select a literal.
+ * Select the next choice literal.  Choices that are already TRUE are
+ * skipped, and 'failed' is set if a choice is FALSE.  Returns LITERAL_NIL
+ * once all choices are TRUE.  After backtracking to (or below) the highest
+ * level of any choice, the choices are re-scanned from the start.
  */
-static literal_t sat_select_literal(literal_t *lits)
+static literal_t sat_select_choice(literal_t *choices, bool *failed)
 {
-    literal_t lit = LITERAL_NIL;
-
-#if 0
-    // Random:
-    if ((sat_rand() & 0xFF) <= SAT_RANDOM)
+    if (sat_dlevel <= sat_choice_dlevel)
     {
-        index_t i = sat_rand() % sat_vars_length;
-        literal_t lit_i = literal_makeindex(i);
-        lit_i = sat_should_select_literal(lit_i);
-        if (lit_i != LITERAL_NIL)
+        sat_choice_next   = 0;
+        sat_choice_dlevel = 0;
+    }
+    while (!literal_isnil(choices[sat_choice_next]))
+    {
+        literal_t lit = choices[sat_choice_next];
+        if (literal_isfalse(lit))
         {
-            lit = lit_i;
-            goto found_literal;
+            debug("!cFAILED CHOICE!d %s", sat_show_literal(lit));
+            sat_analyze_core(lit);
+            *failed = true;
+            return LITERAL_NIL;
         }
-    }
+        sat_choice_next++;
+        if (literal_isfree(lit))
+        {
+            debug("!gCHOICE!d %s", sat_show_literal(lit));
+            stat_decisions++;
+            sat_choice_dlevel = sat_dlevel;
+            return lit;
+        }
+        if (literal_getdlevel(lit) > sat_choice_dlevel)
+            sat_choice_dlevel = literal_getdlevel(lit);
+    }
+    return LITERAL_NIL;
+}
+
+/*
+ * Compute the unsat core for the failed choice 'lit', i.e. 'lit' plus the
+ * choices (decisions) that imply its negation.  This is the final conflict
+ * analysis: the reasons of the marked literals are expanded (in reverse trail
+ * order) back to the decisions.
+ */
+static void sat_analyze_core(literal_t lit)
+{
+    sat_core_len = 0;
+    sat_core[sat_core_len++] = lit;
+    if (literal_getdlevel(lit) == 0)
+        return;
+    literal_setmark(lit, true);
+    for (level_t i = sat_tlevel-1; i >= 0; i--)
+    {
+        literal_t lit_i = sat_trail[i];
+        if (literal_getdlevel(lit_i) == 0)
+            break;
+        if (!literal_getmark(lit_i))
+            continue;
+        literal_setmark(lit_i, false);
+        clause_ref_t reason = sat_get_reason(lit_i);
+        if (reason == SAT_CLAUSE_NONE)
+        {
+            if (lit_i != literal_negate(lit))
+                sat_core[sat_core_len++] = lit_i;
+            continue;
+        }
+        literal_t buf[2];
+        uint32_t len;
+        literal_t *lits = sat_reason_lits(lit_i, reason, buf, &len);
+        for (uint32_t j = 1; j < len; j++)
+        {
+            if (literal_getdlevel(lits[j]) != 0)
+                literal_setmark(lits[j], true);
+        }
+    }
+    debug("!cCORE!d %s", sat_show_lits(sat_core, sat_core_len));
+}
+
+/*
+ * Select a literal.
+ */
+static literal_t sat_select_literal(literal_t *lits)
+{
+    literal_t lit = LITERAL_NIL;
+
+#if 0
+    // Random:
+    if ((sat_rand() & 0xFF) <= SAT_RANDOM)
+    {
+        index_t i = sat_rand() % sat_vars_length;
+        literal_t lit_i = literal_makeindex(i);
+        lit_i = sat_should_select_literal(lit_i);
+        if (lit_i != LITERAL_NIL)
+        {
+            lit = lit_i;
+            goto found_literal;
+        }
+    }
 #endif
 
 #if 0 
     // Clause-list:
     for (size_t ttl = 256; ttl != 0 && sat_next_clause >= 0; ttl--)
     {
-        clause_t clause = sat_clauses[sat_next_clause];
+        clause_t clause = sat_clause(sat_clauses[sat_next_clause]);
         sat_next_clause--;
         bool found = true;
-        int best_score = 0;
+        double best_score = 0;
         literal_t lit_1 = LITERAL_NIL;
         for (size_t i = 0; i < clause->length; i++)
         {
@@ -1043,7 +2224,7 @@ static literal_t sat_select_literal(literal_t *lits)
             }
             if (literal_isfalse(lit_i))
                 continue;
-            int score = literal_getactivity(lit_i);
+            double score = literal_getactivity(lit_i);
             if (score > best_score)
             {
                 lit_1 = lit_i;
@@ -1063,16 +2244,21 @@ static literal_t sat_select_literal(literal_t *lits)
 #endif
  
     // VSIDS:
-    for (index_t i = sat_next_var; i < sat_vars_length; i++)
+    while (sat_heap_len > 0)
     {
-        literal_t lit_i = literal_makeindex(sat_order[i]);
+        index_t i = sat_heap_pop();
+        literal_t lit_i = literal_makeindex(i);
+        if (!literal_isfree(lit_i))
+            continue;
         lit_i = sat_should_select_literal(lit_i);
         if (lit_i != LITERAL_NIL)
         {
             lit = lit_i;
-            sat_next_var = i+1;
             break;
         }
+        sat_skipped[sat_skipped_len].idx    = i;
+        sat_skipped[sat_skipped_len].dlevel = sat_dlevel;
+        sat_skipped_len++;
     }
 
     // Fall-back (activity == 0)
@@ -1101,8 +2287,8 @@ static literal_t sat_select_literal(literal_t *lits)
                 literal_t lit_d = sat_should_select_literal((literal_t)d->b);
                 if (lit_d != LITERAL_NIL)
                 {
+                    literal_reorder(lit);
                     lit = lit_d;
-                    sat_next_var--;
                     goto found_literal;
                 }
             }
@@ -1113,7 +2299,7 @@ found_literal:
 
     if (lit != LITERAL_NIL)
     {
-        debug("!gSELECT!d %s [activity=%u]", sat_show_literal(lit),
+        debug("!gSELECT!d %s [activity=%g]", sat_show_literal(lit),
             literal_getactivity(lit));
         stat_decisions++;
         sat_last_var = literal_getindex(lit);
@@ -1138,18 +2324,133 @@ extern void sat_add_clause(literal_t *lits, size_t len, bool keep,
         sat_eager_clause(lits, len);
 }
 
+/*
+ * Propagate a literal with a deferred explanation.  The explanation is only
+ * constructed (by calling 'explain') if the literal's reason is needed
+ * during conflict analysis.  Otherwise (not solving, debugging, or the
+ * literal is already set) the explanation is constructed immediately and
+ * added as a normal (non-keep) lazy clause.
+ */
+extern void sat_lazy_propagate(literal_t lit, explain_t explain,
+    const void *data, size_t size, const char *solver, size_t lineno)
+{
+    if (size > SAT_EXPLAIN_SIZE)
+        panic("at (%s:%zu) explanation payload is too large (%zu bytes)",
+            solver, lineno, size);
+    if (!sat_solving || option_debug_on || !literal_isfree(lit))
+    {
+        reason_t reason = make_reason();
+        explain(lit, data, reason);
+        consequent(reason, lit);
+        sat_add_clause(reason->lits, reason->len, false, solver, lineno);
+        return;
+    }
+
+    debug("!rDEFER!d %s (%s:%zu)", sat_show_literal(lit), solver, lineno);
+    stat_deferred++;
+    struct deferred_s *deferred = sat_deferred + literal_getindex(lit);
+    deferred->explain = explain;
+    deferred->lit     = lit;
+    memcpy(deferred->data, data, size);
+    literal_set(lit, sat_deferred_reason);
+}
+
+/*
+ * Get the reason for a literal, constructing any deferred explanation.
+ */
+static clause_ref_t sat_get_reason(literal_t lit)
+{
+    clause_ref_t reason = literal_getreason(lit);
+    if (reason == sat_deferred_reason)
+        reason = sat_explain(lit);
+    return reason;
+}
+
+/*
+ * Construct the deferred explanation for the variable of 'lit' (of either
+ * sign).  The explanation becomes an explanation clause (with the propagated
+ * literal as the implied literal) that replaces the literal's reason.
+ * Literal marks are in use by the conflict analysis, so duplicate literals
+ * are not removed.
+ */
+static clause_ref_t sat_explain(literal_t lit)
+{
+    stat_explained++;
+    struct deferred_s *deferred = sat_deferred + literal_getindex(lit);
+    lit = deferred->lit;
+    reason_t reason = make_reason();
+    consequent(reason, lit);
+    deferred->explain(lit, deferred->data, reason);
+    literal_t *lits = reason->lits;
+    uint32_t len = 1;
+    for (uint32_t i = 1; i < reason->len; i++)
+    {
+        if (!literal_isnil(lits[i]) && lits[i] != LITERAL_FALSE)
+            lits[len++] = lits[i];
+    }
+    if (len < 2)
+        panic("empty deferred explanation for %s", sat_show_literal(lit));
+
+    // The most recent antecedent is the second watch:
+    for (uint32_t i = 2; i < len; i++)
+    {
+        check(literal_isfalse(lits[i]));
+        if (literal_getdlevel(lits[i]) > literal_getdlevel(lits[1]))
+        {
+            literal_t tmp = lits[1];
+            lits[1] = lits[i];
+            lits[i] = tmp;
+        }
+    }
+    check(literal_isfalse(lits[1]));
+    debug("!rEXPLAIN!d %s", sat_show_lits(lits, len));
+
+    stat_clauses++;
+    clause_ref_t ref;
+    if (len == 2)
+    {
+        literal_addbinary(lits[0], lits[1]);
+        literal_addbinary(lits[1], lits[0]);
+        ref = sat_binary_reason(lits[1]);
+    }
+    else
+    {
+        ref = sat_alloc_clause(lits, len, false);
+        literal_addwatch(lits[0], ref, lits[1]);
+        literal_addwatch(lits[1], ref, lits[0]);
+        sat_explains[sat_explains_len++] = ref;
+    }
+    literal_setreason(lit, ref);
+    return ref;
+}
+
 /*
  * Create an eager (initial) clause.
  */
-static clause_t sat_eager_clause(literal_t *lits, size_t litslen)
+static clause_ref_t sat_eager_clause(literal_t *lits, size_t litslen)
 {
-    return sat_init_clause(lits, litslen, false);
+    if (sat_tlevel == 0)
+        return sat_init_clause(lits, litslen, false);
+
+    // Incremental mode: simplify w.r.t. the level 0 assignment:
+    literal_t new_lits[litslen+1];
+    size_t j = 0;
+    for (size_t i = 0; i < litslen; i++)
+    {
+        literal_t lit = lits[i];
+        if (literal_istrue(lit))
+            return SAT_CLAUSE_NONE;
+        if (!literal_isfalse(lit))
+            new_lits[j++] = lit;
+    }
+    return sat_init_clause(new_lits, j, false);
 }
 
 /*
  * Create a new SAT clause (generated during setup).
  */
-static clause_t sat_init_clause(literal_t *lits, size_t litslen, bool learnt)
+static clause_ref_t sat_init_clause(literal_t *lits, size_t litslen,
+    bool learnt)
 {
     debug("!r%s!d %s", (learnt? "LEARNT": "EAGER"),
         sat_show_lits(lits, litslen));
@@ -1158,20 +2459,20 @@ static clause_t sat_init_clause(literal_t *lits, size_t litslen, bool learnt)
     {
         case 0:
             sat_empty = true;
-            return NULL;
+            return SAT_CLAUSE_NONE;
         case 1:
             if (literal_isunit(lits[0]))
-                return NULL;
+                return SAT_CLAUSE_NONE;
             if (literal_isunit(literal_negate(lits[0])))
             {
                 sat_empty = true;
-                return NULL;
+                return SAT_CLAUSE_NONE;
             }
             literal_setunit(lits[0]);
-            return NULL;
+            return SAT_CLAUSE_NONE;
         default:
         {
-            clause_t clause = sat_new_clause(lits, litslen);
+            clause_ref_t clause = sat_new_clause(lits, litslen, learnt);
             return clause;
         }
     }
@@ -1180,16 +2481,42 @@ static clause_t sat_init_clause(literal_t *lits, size_t litslen, bool learnt)
 /*
  * Create a new SAT clause.
  */
-static clause_t sat_new_clause(literal_t *lits, size_t litslen)
+static clause_ref_t sat_new_clause(literal_t *lits, size_t litslen,
+    bool learnt)
+{
+    if (litslen == 2)
+    {
+        literal_addbinary(lits[0], lits[1]);
+        literal_addbinary(lits[1], lits[0]);
+        return sat_binary_reason(lits[1]);
+    }
+    clause_ref_t clause = sat_alloc_clause(lits, litslen, learnt);
+    literal_addwatch(lits[0], clause, lits[1]);
+    literal_addwatch(lits[1], clause, lits[0]);
+    return clause;
+}
+
+/*
+ * Allocate a clause in the clause arena.
+ */
+static clause_ref_t sat_alloc_clause(literal_t *lits, size_t litslen,
+    bool learnt)
 {
-    clause_t clause = (clause_t)gc_malloc(sizeof(struct clause_s) +
-        litslen*sizeof(literal_t));
-    clause->length = (uint32_t)litslen;
+    size_t size = sat_clause_size(litslen);
+    if ((sat_arena_len + size)*sizeof(uint32_t) > SAT_ARENA_SIZE)
+        panic("failed to allocate clause of length %zu: clause arena is "
+            "full", litslen);
+    clause_ref_t ref = (clause_ref_t)sat_arena_len;
+    sat_arena_len += size;
+    clause_t clause = sat_clause(ref);
+    clause->length   = (uint32_t)litslen;
+    clause->lbd      = 0;
+    clause->learnt   = learnt;
+    clause->deleted  = false;
+    clause->activity = 0;
     for (uint32_t i = 0; i < litslen; i++)
         clause->lits[i] = lits[i];
-    literal_addwatch(lits[0], clause);
-    literal_addwatch(lits[1], clause);
-    return clause;
+    return ref;
 }
 
 /*
@@ -1312,6 +2639,7 @@ static void sat_lazy_clause(literal_t *lits, size_t len, bool keep,
 
     literal_t new_lits[len+1];
     size_t j = 0;
+    uint64_t hash = 0;
 
     for (size_t i = 0; i < len; i++)
     {
@@ -1320,228 +2648,1388 @@ static void sat_lazy_clause(literal_t *lits, size_t len, bool keep,
             continue;
         if (lit == LITERAL_FALSE)
             continue;
+        check(!literal_getvar(lit)->elim);
         if (literal_getmark(lit))
         {
             bool conflict = false;
             for (size_t k = 0; k < j; k++)
             {
-                literal_t lit_k = new_lits[k];
-                if (lit == lit_k)
-                    break;
-                if (lit == literal_negate(lit_k))
+                literal_t lit_k = new_lits[k];
+                if (lit == lit_k)
+                    break;
+                if (lit == literal_negate(lit_k))
+                {
+                    conflict = true;
+                    break;
+                }
+            }
+            if (!conflict)
+                // Redundant literal x \/ x -> x
+                continue;
+
+            // Redundant x \/ -x -> true
+            DEBUG("!rLAZY!d %s (!yTRUE!d [useless])",
+                sat_show_lits(lits, len));
+            goto unmark_and_return;
+        }
+        sat_clause_insert_literal(new_lits, lit, j);
+        j++;
+        literal_setmark(lit, true);
+        hash += sat_lazy_hash(lit);
+    }
+
+    // Check for unit clauses:
+    literal_t lit_0 = new_lits[0];
+    if (j == 1)
+    {
+        if (literal_istrue(lit_0))
+            goto unmark_and_return;
+        sat_unwind(sat_tlevel-1, 0);
+        if (literal_isfalse(lit_0))
+        {
+            sat_empty = true;
+            debug_step(DEBUG_FAIL, true, new_lits, 1, solver, lineno);
+            sat_action(SAT_ACTION_FAIL);
+        }
+        literal_setmark(lit_0, false);
+        sat_reason_0 = lit_0;
+        debug_step(DEBUG_PROPAGATE, true, new_lits, 1, solver, lineno);
+        sat_action(SAT_ACTION_RESTART);
+        panic("SAT restart failed");
+    }
+
+    // Redundant clause (case 1):
+    literal_t lit_1 = new_lits[1];
+    if (!keep && literal_istrue(lit_0))
+    {
+        DEBUG("!rLAZY!d %s (!yREDUNDANT!d [true])",
+            sat_show_lits(new_lits, j));
+        goto unmark_and_return;
+    }
+
+    // Redundant clause (case 2):
+    if (!keep && literal_isfree(lit_0) && literal_isfree(lit_1) &&
+            sat_clause_istrue(new_lits, j))
+    {
+        DEBUG("!rLAZY!d %s (!yREDUNDANT DISJUNCTION!d)",
+            sat_show_lits(new_lits, j));
+        goto unmark_and_return;
+    }
+
+    // Check for late clauses:
+    if (literal_isfalse(lit_0) && literal_getdlevel(lit_0) != sat_dlevel)
+    {
+        panic("at (%s:%zu) late fail clause (!y%s!d); expected level %d, got "
+            "level %d", solver, lineno, sat_show_lits(new_lits, j), sat_dlevel,
+            literal_getdlevel(lit_0));
+        goto unmark_and_return;
+    }
+    if (literal_isfree(lit_0) && literal_isfalse(lit_1) &&
+        literal_getdlevel(lit_1) != sat_dlevel)
+    {
+        panic("at (%s:%zu) late propagation clause (!y%s!d); expected level "
+            "%d, got level %d", solver, lineno, sat_show_lits(new_lits, j),
+            sat_dlevel, literal_getdlevel(lit_1));
+        goto unmark_and_return;
+    }
+
+    // Check for duplicate clauses (needs the marks):
+    clause_ref_t dup;
+    if (hash == 0)
+        hash = 1;
+    bool duplicate = sat_lazy_find(hash, new_lits, j, keep, &dup);
+
+    // Clear the marks:
+    for (size_t i = 0; i < j; i++)
+    {
+        literal_t lit = new_lits[i];
+        literal_setmark(lit, false);
+        if (literal_isfree(lit))
+            literal_reorder(lit);
+    }
+
+    // Create the clause:
+    clause_ref_t ref, reason;
+    if (duplicate)
+    {
+        // Duplicate clause; only needed if it propagates or fails.  The
+        // existing clause is re-watched using the new literal order.
+        stat_duplicate_clauses++;
+        if (!literal_isfalse(lit_0) &&
+                !(literal_isfree(lit_0) && literal_isfalse(lit_1)))
+        {
+            DEBUG("!rLAZY!d %s (!yDUPLICATE!d)",
+                sat_show_lits(new_lits, j));
+            return;
+        }
+        if (j == 2)
+        {
+            ref = sat_binary_conflict;
+            sat_clause(ref)->lits[0] = lit_0;
+            sat_clause(ref)->lits[1] = lit_1;
+            reason = sat_binary_reason(lit_1);
+        }
+        else
+        {
+            sat_lazy_rewatch(dup, new_lits);
+            ref = reason = dup;
+        }
+    }
+    else if (j == 2)
+    {
+        // Binary clause:
+        stat_clauses++;
+        literal_addbinary(lit_0, lit_1);
+        literal_addbinary(lit_1, lit_0);
+        ref = sat_binary_conflict;
+        sat_clause(ref)->lits[0] = lit_0;
+        sat_clause(ref)->lits[1] = lit_1;
+        reason = sat_binary_reason(lit_1);
+        sat_lazy_insert(hash, SAT_CLAUSE_NONE, true);
+    }
+    else
+    {
+        stat_clauses++;
+        ref = sat_alloc_clause(new_lits, j, false);
+
+        // Create watch literals:
+        literal_addwatch(lit_0, ref, lit_1);
+        literal_addwatch(lit_1, ref, lit_0);
+        reason = ref;
+        sat_lazy_insert(hash, ref, keep);
+        if (!keep)
+            sat_explains[sat_explains_len++] = ref;
+    }
+    clause_t clause = sat_clause(ref);
+
+    // Do any required propagation:
+    if (literal_isfree(lit_0) && literal_isfalse(lit_1))
+    {
+        DEBUG("!rLAZY!d %s (!yPROPAGATE!d %s)", sat_show_clause(clause),
+            sat_show_literal(lit_0));
+        debug_step(DEBUG_PROPAGATE, true, clause->lits, clause->length,
+            solver, lineno);
+        literal_set(lit_0, reason);
+        return;
+    }
+    if (literal_isfalse(lit_0))
+    {
+        DEBUG("!rLAZY!d %s (!yFAIL!d)", sat_show_clause(clause));
+        debug_step(DEBUG_FAIL, true, clause->lits, clause->length, solver,
+            lineno);
+        sat_reason = ref;
+        sat_action(SAT_ACTION_FAIL);
+        panic("SAT failure failed");
+    }
+    debug_step(DEBUG_PROPAGATE, true, clause->lits, clause->length, solver,
+        lineno);
+    DEBUG("!rLAZY!d %s (!ySLEEP!d)", sat_show_clause(clause));
+    return;
+
+unmark_and_return:
+    for (size_t i = 0; i < j; i++)
+        literal_setmark(new_lits[i], false);
+    return;
+}
+#undef DEBUG
+
+/*
+ * Hash a literal for the lazy clause table.  The hash of a clause is the sum
+ * of its literal hashes, so is independent of the literal order.
+ */
+static uint64_t sat_lazy_hash(literal_t lit)
+{
+    uint64_t h = (uint64_t)(uint32_t)lit * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+/*
+ * Find a lazy clause with the same literals as 'lits'.  The literals of
+ * 'lits' must be marked.  A non-`keep' clause is not a duplicate of a `keep'
+ * clause, since the former may be deleted.
+ */
+static bool sat_lazy_find(uint64_t hash, literal_t *lits, size_t len,
+    bool keep, clause_ref_t *ref)
+{
+    size_t mask = sat_lazy_size - 1;
+    for (size_t i = (size_t)hash & mask; sat_lazy[i].hash != 0;
+            i = (i + 1) & mask)
+    {
+        if (sat_lazy[i].hash != hash || (keep && !sat_lazy[i].keep))
+            continue;
+        if (sat_lazy[i].ref == SAT_CLAUSE_NONE)
+        {
+            // Binary clause:
+            if (len != 2)
+                continue;
+            binary_t binary = literal_getbinary(lits[0]);
+            for (uint32_t j = 0; j < binary->length; j++)
+            {
+                if (binary->lits[j] == lits[1])
+                {
+                    *ref = SAT_CLAUSE_NONE;
+                    return true;
+                }
+            }
+            continue;
+        }
+        clause_t clause = sat_clause(sat_lazy[i].ref);
+        if (clause->deleted || clause->length != len)
+            continue;
+        size_t j;
+        for (j = 0; j < len && literal_getmark(clause->lits[j]); j++)
+            ;
+        if (j >= len)
+        {
+            *ref = sat_lazy[i].ref;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Insert a lazy clause into the table.
+ */
+static void sat_lazy_insert(uint64_t hash, clause_ref_t ref, bool keep)
+{
+    if (4*(sat_lazy_len+1) > 3*sat_lazy_size)
+        sat_lazy_rebuild(2*sat_lazy_size);
+    size_t mask = sat_lazy_size - 1;
+    size_t i = (size_t)hash & mask;
+    while (sat_lazy[i].hash != 0)
+        i = (i + 1) & mask;
+    sat_lazy[i].hash = hash;
+    sat_lazy[i].ref  = ref;
+    sat_lazy[i].keep = keep;
+    sat_lazy_len++;
+}
+
+/*
+ * Rebuild the lazy clause table with the given size (or larger).  Entries
+ * for deleted clauses are dropped.
+ */
+static void sat_lazy_rebuild(size_t size)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < sat_lazy_size; i++)
+    {
+        if (sat_lazy[i].hash != 0 && (sat_lazy[i].ref == SAT_CLAUSE_NONE ||
+                !sat_clause(sat_lazy[i].ref)->deleted))
+            len++;
+    }
+    while (4*(len+1) > 3*size)
+        size *= 2;
+    if (size*sizeof(struct lazy_s) > 0x3FFFFFFF)
+        panic("failed to grow lazy clause table: table is full");
+    memset(sat_lazy_spare, 0, size*sizeof(struct lazy_s));
+    size_t mask = size - 1;
+    for (size_t i = 0; i < sat_lazy_size; i++)
+    {
+        struct lazy_s *entry = sat_lazy + i;
+        if (entry->hash == 0 || (entry->ref != SAT_CLAUSE_NONE &&
+                sat_clause(entry->ref)->deleted))
+            continue;
+        size_t j = (size_t)entry->hash & mask;
+        while (sat_lazy_spare[j].hash != 0)
+            j = (j + 1) & mask;
+        sat_lazy_spare[j] = *entry;
+    }
+    struct lazy_s *tmp = sat_lazy;
+    sat_lazy = sat_lazy_spare;
+    sat_lazy_spare = tmp;
+    sat_lazy_size = size;
+    sat_lazy_len = len;
+}
+
+/*
+ * Re-watch an existing clause using the (same) literals 'lits' in a new
+ * order.
+ */
+static void sat_lazy_rewatch(clause_ref_t ref, literal_t *lits)
+{
+    clause_t clause = sat_clause(ref);
+    for (size_t s = 0; s < 2; s++)
+    {
+        watch_t watch = literal_getwatch(clause->lits[s]);
+        for (uint32_t i = 0; i < watch->length; i++)
+        {
+            if (watch->watchers[i].clause == ref)
+            {
+                sat_watch_delete(watch, i);
+                break;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < clause->length; i++)
+        clause->lits[i] = lits[i];
+    literal_addwatch(lits[0], ref, lits[1]);
+    literal_addwatch(lits[1], ref, lits[0]);
+}
+
+/*
+ * Test if a clause is redundant.
+ */
+static bool sat_clause_istrue(literal_t *lits, size_t len)
+{
+    // Search for matching clause:
+    for (size_t i = 0; i < len && literal_isfree(lits[i]); i++)
+    {
+        binary_t binary = literal_getbinary(lits[i]);
+        for (size_t j = 0; j < binary->length; j++)
+        {
+            literal_t lit = binary->lits[j];
+            if (literal_istrue(lit))
+                continue;
+            bool found = literal_isfalse(lit);
+            for (size_t l = 0; !found && l < len &&
+                    literal_isfree(lits[l]); l++)
+                found = (lit == lits[l]);
+            if (found)
+            {
+                debug("SUBSUMED %s BY %s \\/ %s", sat_show_lits(lits, len),
+                    sat_show_literal(lits[i]), sat_show_literal(lit));
+                return true;
+            }
+        }
+        watch_t watch = literal_getwatch(lits[i]);
+        for (size_t j = 0; j < watch->length; j++)
+        {
+            clause_t clause = sat_clause(watch->watchers[j].clause);
+
+            // Check if every free literal in clause is free in lits:
+            size_t k;
+            for (k = 0; k < clause->length; k++)
+            {
+                literal_t lit = clause->lits[k];
+                if (lit == lits[i])
+                    continue;
+                if (literal_isfalse(lit))
+                    continue;
+                if (literal_istrue(lit))
+                    break;
+                bool found = false;
+                for (size_t l = 0; !found && l < len &&
+                        literal_isfree(lits[l]); l++)
+                    found = (lit == lits[l]);
+                if (!found)
+                    break;
+            }
+            if (k >= clause->length)
+            {
+                debug("SUBSUMED %s BY %s", sat_show_lits(lits, len),
+                    sat_show_clause(clause));
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/****************************************************************************/
+/* WATCHES                                                                  */
+/****************************************************************************/
+
+/*
+ * Create a new SAT watch.
+ */
+static watch_t sat_watch_new(void)
+{
+    size_t watch_size = 2;
+    watch_t watch = (watch_t)gc_malloc(sizeof(struct watch_s) +
+        watch_size*sizeof(struct watcher_s));
+    watch->size   = watch_size;
+    watch->length = 0;
+    return watch;
+}
+
+/*
+ * Make literal watch clause.
+ */
+static void literal_addwatch(literal_t lit, clause_ref_t clause,
+    literal_t blocker)
+{
+    watch_t watch = literal_getwatch(lit);
+    if (watch->length+1 >= watch->size)
+    {
+        watch->size *= 2;
+        watch = (watch_t)gc_realloc(watch, sizeof(struct watch_s) +
+            watch->size*sizeof(struct watcher_s));
+        literal_setwatch(lit, watch);
+    }
+    watch->watchers[watch->length].clause  = clause;
+    watch->watchers[watch->length].blocker = blocker;
+    watch->length++;
+}
+
+/*
+ * Remove watch from literal.
+ */
+static void sat_watch_delete(watch_t watch, uint32_t idx)
+{
+    watch->length--;
+    watch->watchers[idx] = watch->watchers[watch->length];
+}
+
+/*
+ * Create a new binary clause list.
+ */
+static binary_t sat_binary_new(void)
+{
+    size_t binary_size = 2;
+    binary_t binary = (binary_t)gc_malloc(sizeof(struct binary_s) +
+        binary_size*sizeof(literal_t));
+    binary->size   = binary_size;
+    binary->length = 0;
+    return binary;
+}
+
+/*
+ * Add the binary clause (lit \/ implied) to lit's binary clause list.
+ */
+static void literal_addbinary(literal_t lit, literal_t implied)
+{
+    binary_t binary = literal_getbinary(lit);
+    if (binary->length+1 >= binary->size)
+    {
+        binary->size *= 2;
+        binary = (binary_t)gc_realloc(binary, sizeof(struct binary_s) +
+            binary->size*sizeof(literal_t));
+        literal_setbinary(lit, binary);
+    }
+    binary->lits[binary->length] = implied;
+    binary->length++;
+}
+
+/****************************************************************************/
+/* PREPROCESSING                                                            */
+/****************************************************************************/
+
+/*
+ * Preprocessing works on a detached copy of the eager clauses with full
+ * occurrence lists.  The surviving clauses are re-attached to the watch lists
+ * before search.
+ */
+struct pre_clause_s
+{
+    uint64_t sig;               // Variable signature.
+    uint32_t length;            // Clause length.
+    bool deleted;               // Is clause deleted?
+    bool queued;                // Is clause queued for subsumption?
+    literal_t lits[];           // Clause literals.
+};
+typedef struct pre_clause_s *pre_clause_t;
+
+struct pre_occs_s
+{
+    uint32_t size;              // Occurrence list size.
+    uint32_t length;            // Occurrence list length.
+    pre_clause_t *clauses;      // Occurrence list clauses.
+};
+typedef struct pre_occs_s *pre_occs_t;
+
+// Preprocessing state.
+static pre_clause_t *sat_pre_clauses;
+                                // All clauses.
+static size_t sat_pre_clauses_len;
+static size_t sat_pre_clauses_size;
+static pre_occs_t sat_pre_occs; // Occurrence lists (per literal).
+static pre_clause_t *sat_pre_queue;
+                                // Subsumption queue.
+static size_t sat_pre_queue_len;
+static size_t sat_pre_queue_size;
+static literal_t *sat_pre_units;
+                                // Unit literals found.
+static size_t sat_pre_units_len;
+static int8_t *sat_pre_vals;    // Unit assignments (per variable).
+static bool sat_pre_empty;      // Empty clause found?
+
+/*
+ * Literal helpers.
+ */
+static inline int sat_pre_value(literal_t lit)
+{
+    int8_t value = sat_values[literal_getcode(lit)];
+    if (value != 0)
+        return value;
+    int val = sat_pre_vals[literal_getindex(lit)];
+    return (literal_getsign(lit)? -val: val);
+}
+static inline bool sat_is_frozen(literal_t lit)
+{
+    variable_t var = literal_getvar(lit);
+    return (var->cons != NULL || var->frozen);
+}
+static inline uint64_t sat_pre_sig(literal_t lit)
+{
+    return ((uint64_t)1 << (literal_getindex(lit) & 63));
+}
+static int sat_pre_lit_compare(const void *a, const void *b)
+{
+    literal_t la = *(literal_t *)a, lb = *(literal_t *)b;
+    size_t ca = literal_getcode(la), cb = literal_getcode(lb);
+    return (ca < cb? -1: (ca > cb? 1: 0));
+}
+
+/*
+ * Occurrence lists.
+ */
+static void sat_pre_occs_add(literal_t lit, pre_clause_t clause)
+{
+    pre_occs_t occs = sat_pre_occs + literal_getcode(lit);
+    if (occs->length >= occs->size)
+    {
+        occs->size = 2 * occs->size + 4;
+        occs->clauses = (pre_clause_t *)gc_realloc(occs->clauses,
+            occs->size * sizeof(pre_clause_t));
+    }
+    occs->clauses[occs->length++] = clause;
+}
+static void sat_pre_occs_remove(literal_t lit, pre_clause_t clause)
+{
+    pre_occs_t occs = sat_pre_occs + literal_getcode(lit);
+    for (uint32_t i = 0; i < occs->length; i++)
+    {
+        if (occs->clauses[i] == clause)
+        {
+            occs->clauses[i] = occs->clauses[--occs->length];
+            return;
+        }
+    }
+}
+static pre_occs_t sat_pre_occs_get(literal_t lit)
+{
+    // Also purges deleted clauses:
+    pre_occs_t occs = sat_pre_occs + literal_getcode(lit);
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < occs->length; i++)
+    {
+        if (!occs->clauses[i]->deleted)
+            occs->clauses[k++] = occs->clauses[i];
+    }
+    occs->length = k;
+    return occs;
+}
+
+/*
+ * Queue a clause for subsumption checking.
+ */
+static void sat_pre_enqueue(pre_clause_t clause)
+{
+    if (clause->queued)
+        return;
+    if (sat_pre_queue_len >= sat_pre_queue_size)
+    {
+        sat_pre_queue_size = 2 * sat_pre_queue_size + 64;
+        sat_pre_queue = (pre_clause_t *)gc_realloc(sat_pre_queue,
+            sat_pre_queue_size * sizeof(pre_clause_t));
+    }
+    clause->queued = true;
+    sat_pre_queue[sat_pre_queue_len++] = clause;
+}
+
+/*
+ * Record a unit found during preprocessing.
+ */
+static void sat_pre_unit(literal_t lit)
+{
+    int val = sat_pre_value(lit);
+    if (val > 0)
+        return;
+    if (val < 0)
+    {
+        sat_pre_empty = true;
+        return;
+    }
+    debug("!cPREPROCESS UNIT!d %s", sat_show_literal(lit));
+    sat_pre_vals[literal_getindex(lit)] = (literal_getsign(lit)? -1: 1);
+    sat_pre_units[sat_pre_units_len++] = lit;
+}
+
+/*
+ * Add a clause to the preprocessing database.  Returns NULL if the clause is
+ * TRUE, a unit, or empty.
+ */
+static pre_clause_t sat_pre_add(literal_t *lits, size_t len)
+{
+    literal_t buf[len];
+    size_t j = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        int val = sat_pre_value(lits[i]);
+        if (val > 0)
+            return NULL;
+        if (val == 0)
+            buf[j++] = lits[i];
+    }
+    qsort(buf, j, sizeof(literal_t), sat_pre_lit_compare);
+    size_t k = 0;
+    for (size_t i = 0; i < j; i++)
+    {
+        if (k > 0 && buf[k-1] == buf[i])
+            continue;
+        if (k > 0 && buf[k-1] == literal_negate(buf[i]))
+            return NULL;
+        buf[k++] = buf[i];
+    }
+    switch (k)
+    {
+        case 0:
+            sat_pre_empty = true;
+            return NULL;
+        case 1:
+            sat_pre_unit(buf[0]);
+            return NULL;
+        default:
+            break;
+    }
+
+    pre_clause_t clause = (pre_clause_t)gc_malloc(sizeof(struct pre_clause_s)
+        + k*sizeof(literal_t));
+    clause->sig     = 0;
+    clause->length  = k;
+    clause->deleted = false;
+    clause->queued  = false;
+    for (size_t i = 0; i < k; i++)
+    {
+        clause->lits[i] = buf[i];
+        clause->sig |= sat_pre_sig(buf[i]);
+        sat_pre_occs_add(buf[i], clause);
+    }
+    if (sat_pre_clauses_len >= sat_pre_clauses_size)
+    {
+        sat_pre_clauses_size = 2 * sat_pre_clauses_size + 64;
+        sat_pre_clauses = (pre_clause_t *)gc_realloc(sat_pre_clauses,
+            sat_pre_clauses_size * sizeof(pre_clause_t));
+    }
+    sat_pre_clauses[sat_pre_clauses_len++] = clause;
+    sat_pre_enqueue(clause);
+    return clause;
+}
+
+/*
+ * Remove a literal from a clause (strengthening).
+ */
+static void sat_pre_strengthen(pre_clause_t clause, literal_t lit)
+{
+    uint32_t k = 0;
+    clause->sig = 0;
+    for (uint32_t i = 0; i < clause->length; i++)
+    {
+        if (clause->lits[i] == lit)
+            continue;
+        clause->lits[k++] = clause->lits[i];
+        clause->sig |= sat_pre_sig(clause->lits[i]);
+    }
+    clause->length = k;
+    sat_pre_occs_remove(lit, clause);
+    if (k == 1)
+    {
+        clause->deleted = true;
+        sat_pre_unit(clause->lits[0]);
+        return;
+    }
+    sat_pre_enqueue(clause);
+}
+
+/*
+ * Apply the unit assignments to the clause database.
+ */
+static void sat_pre_propagate(size_t *next)
+{
+    while (*next < sat_pre_units_len && !sat_pre_empty)
+    {
+        literal_t lit = sat_pre_units[(*next)++];
+        pre_occs_t occs = sat_pre_occs_get(lit);
+        for (uint32_t i = 0; i < occs->length; i++)
+            occs->clauses[i]->deleted = true;
+        occs = sat_pre_occs_get(literal_negate(lit));
+        while (occs->length > 0 && !sat_pre_empty)
+            sat_pre_strengthen(occs->clauses[0], literal_negate(lit));
+    }
+}
+
+/*
+ * Subsumption and self-subsuming strengthening using the given clause.
+ */
+static void sat_pre_subsume(pre_clause_t clause)
+{
+    // Find the literal with the shortest occurrence lists:
+    literal_t best = clause->lits[0];
+    size_t best_len = SIZE_MAX;
+    for (uint32_t i = 0; i < clause->length; i++)
+    {
+        literal_t lit = clause->lits[i];
+        size_t len = sat_pre_occs[literal_getcode(lit)].length +
+            sat_pre_occs[literal_getcode(literal_negate(lit))].length;
+        if (len < best_len)
+        {
+            best = lit;
+            best_len = len;
+        }
+    }
+
+    sat_stamp++;
+    if (sat_stamp == 0)
+    {
+        memset(sat_stamps, 0, (sat_vars_length+1)*sizeof(uint32_t));
+        sat_stamp = 1;
+    }
+    for (uint32_t i = 0; i < clause->length; i++)
+        sat_stamps[literal_getindex(clause->lits[i])] = sat_stamp;
+
+    for (int s = 0; s <= 1 && !clause->deleted; s++)
+    {
+        literal_t lit = (s? literal_negate(best): best);
+        pre_occs_t occs = sat_pre_occs_get(lit);
+        for (uint32_t i = 0; i < occs->length && !clause->deleted; i++)
+        {
+            pre_clause_t other = occs->clauses[i];
+            if (other == clause || other->length < clause->length ||
+                    (clause->sig & ~other->sig) != 0)
+                continue;
+
+            // Check clause "subsumes" other, allowing one negated literal:
+            uint32_t count = 0;
+            literal_t neg = LITERAL_NIL;
+            for (uint32_t j = 0; j < other->length; j++)
+            {
+                literal_t lit_j = other->lits[j];
+                if (sat_stamps[literal_getindex(lit_j)] != sat_stamp)
+                    continue;
+                count++;
+                bool found = false;
+                for (uint32_t k = 0; !found && k < clause->length; k++)
+                    found = (clause->lits[k] == lit_j);
+                if (found)
+                    continue;
+                if (neg != LITERAL_NIL)
+                {
+                    count = 0;
+                    break;
+                }
+                neg = lit_j;
+            }
+            if (count != clause->length)
+                continue;
+            if (neg == LITERAL_NIL)
+            {
+                debug("!cSUBSUME!d %s", sat_show_lits(other->lits,
+                    other->length));
+                other->deleted = true;
+                stat_subsumed_clauses++;
+            }
+            else
+            {
+                debug("!cSTRENGTHEN!d %s [%s]", sat_show_lits(other->lits,
+                    other->length), sat_show_literal(neg));
+                sat_pre_strengthen(other, neg);
+                stat_strengthened_clauses++;
+                i--;
+                if (sat_pre_empty)
+                    return;
+            }
+        }
+    }
+}
+
+/*
+ * Run subsumption over all queued clauses.
+ */
+static void sat_pre_run(size_t *next_unit)
+{
+    while (!sat_pre_empty)
+    {
+        sat_pre_propagate(next_unit);
+        if (sat_pre_queue_len == 0 || sat_pre_empty)
+            return;
+        pre_clause_t clause = sat_pre_queue[--sat_pre_queue_len];
+        clause->queued = false;
+        if (!clause->deleted)
+            sat_pre_subsume(clause);
+    }
+}
+
+/*
+ * Attempt to eliminate a variable by clause distribution.
+ */
+static bool sat_pre_eliminate(index_t idx)
+{
+    literal_t pos = literal_makeindex(idx), neg = literal_negate(pos);
+    pre_occs_t pos_occs = sat_pre_occs_get(pos);
+    pre_occs_t neg_occs = sat_pre_occs_get(neg);
+    size_t limit = pos_occs->length + neg_occs->length;
+    if (limit == 0 || limit > SAT_ELIM_OCCS)
+        return false;
+
+    // Count the (non-tautological) resolvents:
+    size_t count = 0;
+    for (uint32_t i = 0; i < pos_occs->length; i++)
+    {
+        pre_clause_t c = pos_occs->clauses[i];
+        for (uint32_t j = 0; j < neg_occs->length; j++)
+        {
+            pre_clause_t d = neg_occs->clauses[j];
+            size_t len = c->length - 1;
+            bool taut = false;
+            for (uint32_t k = 0; !taut && k < d->length; k++)
+            {
+                literal_t lit = d->lits[k];
+                if (lit == neg)
+                    continue;
+                bool found = false;
+                for (uint32_t l = 0; !found && l < c->length; l++)
+                {
+                    if (c->lits[l] == literal_negate(lit))
+                    {
+                        // Theory literals must be decided to reconstruct
+                        // the eliminated variable; give up.
+                        if (sat_is_frozen(lit))
+                            return false;
+                        taut = true;
+                    }
+                    found = (c->lits[l] == lit);
+                }
+                len += !found;
+            }
+            if (taut)
+                continue;
+            count++;
+            if (count > limit || len > SAT_ELIM_LENGTH)
+                return false;
+        }
+    }
+
+    // Eliminate:
+    debug("!cELIMINATE!d %s", sat_show_literal(pos));
+    for (int s = 0; s <= 1; s++)
+    {
+        pre_occs_t occs = (s? neg_occs: pos_occs);
+        literal_t pivot = (s? neg: pos);
+        for (uint32_t i = 0; i < occs->length; i++)
+        {
+            pre_clause_t c = occs->clauses[i];
+            sat_elim[sat_elim_len++] = pivot;
+            for (uint32_t k = 0; k < c->length; k++)
+            {
+                if (c->lits[k] != pivot)
+                    sat_elim[sat_elim_len++] = c->lits[k];
+            }
+            sat_elim[sat_elim_len++] = (literal_t)c->length;
+        }
+    }
+    size_t pos_len = pos_occs->length, neg_len = neg_occs->length;
+    pre_clause_t pos_clauses[pos_len], neg_clauses[neg_len];
+    memcpy(pos_clauses, pos_occs->clauses, pos_len*sizeof(pre_clause_t));
+    memcpy(neg_clauses, neg_occs->clauses, neg_len*sizeof(pre_clause_t));
+    for (size_t i = 0; i < pos_len; i++)
+        pos_clauses[i]->deleted = true;
+    for (size_t i = 0; i < neg_len; i++)
+        neg_clauses[i]->deleted = true;
+    for (size_t i = 0; i < pos_len && !sat_pre_empty; i++)
+    {
+        pre_clause_t c = pos_clauses[i];
+        for (size_t j = 0; j < neg_len && !sat_pre_empty; j++)
+        {
+            pre_clause_t d = neg_clauses[j];
+            literal_t lits[c->length + d->length];
+            size_t len = 0;
+            for (uint32_t k = 0; k < c->length; k++)
+                if (c->lits[k] != pos)
+                    lits[len++] = c->lits[k];
+            for (uint32_t k = 0; k < d->length; k++)
+                if (d->lits[k] != neg)
+                    lits[len++] = d->lits[k];
+            sat_pre_add(lits, len);
+        }
+    }
+    literal_getvar(pos)->elim = true;
+    stat_eliminated_vars++;
+    return true;
+}
+
+/*
+ * Preprocessing variable order.
+ */
+static int sat_pre_var_compare(const void *a, const void *b)
+{
+    index_t ia = *(index_t *)a, ib = *(index_t *)b;
+    literal_t la = literal_makeindex(ia), lb = literal_makeindex(ib);
+    size_t na = (size_t)sat_pre_occs[literal_getcode(la)].length *
+        (size_t)sat_pre_occs[literal_getcode(-la)].length;
+    size_t nb = (size_t)sat_pre_occs[literal_getcode(lb)].length *
+        (size_t)sat_pre_occs[literal_getcode(-lb)].length;
+    return (na < nb? -1: (na > nb? 1: (ia < ib? -1: (ia > ib? 1: 0))));
+}
+
+/*
+ * Simplify the eager clauses: subsumption, self-subsuming strengthening and
+ * bounded variable elimination of pure SAT variables.  Returns false if the
+ * problem is UNSAT.
+ */
+static bool sat_simplify(void)
+{
+    gc_disable();
+    sat_pre_occs = (pre_occs_t)gc_malloc(2*sat_vars_length *
+        sizeof(struct pre_occs_s));
+    memset(sat_pre_occs, 0, 2*sat_vars_length*sizeof(struct pre_occs_s));
+    sat_pre_vals = (int8_t *)gc_malloc(sat_vars_length * sizeof(int8_t));
+    memset(sat_pre_vals, 0, sat_vars_length*sizeof(int8_t));
+    sat_pre_units = (literal_t *)gc_malloc(sat_vars_length *
+        sizeof(literal_t));
+    sat_pre_clauses = NULL;
+    sat_pre_clauses_len = sat_pre_clauses_size = 0;
+    sat_pre_queue = NULL;
+    sat_pre_queue_len = sat_pre_queue_size = 0;
+    sat_pre_units_len = 0;
+    sat_pre_empty = false;
+
+    // Collect & detach the clauses:
+    for (index_t i = 0; i < sat_vars_length; i++)
+    {
+        for (int s = 0; s <= 1; s++)
+        {
+            literal_t lit = literal_makeindex(i);
+            lit = (s? literal_negate(lit): lit);
+            binary_t binary = literal_getbinary(lit);
+            for (uint32_t j = 0; j < binary->length; j++)
+            {
+                literal_t lits[2] = {lit, binary->lits[j]};
+                if (literal_getcode(lits[0]) < literal_getcode(lits[1]))
+                    sat_pre_add(lits, 2);
+            }
+            binary->length = 0;
+            watch_t watch = literal_getwatch(lit);
+            for (uint32_t j = 0; j < watch->length; j++)
+            {
+                clause_t clause = sat_clause(watch->watchers[j].clause);
+                if (clause->lits[0] == lit)
                 {
-                    conflict = true;
-                    break;
+                    sat_pre_add(clause->lits, clause->length);
+                    clause->deleted = true;
+                    sat_arena_wasted += sat_clause_size(clause->length);
                 }
             }
-            if (!conflict)
-                // Redundant literal x \/ x -> x
-                continue;
-
-            // Redundant x \/ -x -> true
-            DEBUG("!rLAZY!d %s (!yTRUE!d [useless])",
-                sat_show_lits(lits, len));
-            goto unmark_and_return;
+            watch->length = 0;
         }
-        sat_clause_insert_literal(new_lits, lit, j);
-        j++;
-        literal_setmark(lit, true);
     }
 
-    // Check for unit clauses:
-    literal_t lit_0 = new_lits[0];
-    if (j == 1)
+    // Subsumption & strengthening:
+    size_t next_unit = 0;
+    sat_pre_run(&next_unit);
+
+    // Bounded variable elimination:
+    index_t *order = (index_t *)gc_malloc(sat_vars_length * sizeof(index_t));
+    size_t order_len = 0;
+    for (index_t i = 1; i < sat_vars_length; i++)
     {
-        if (literal_istrue(lit_0))
-            goto unmark_and_return;
-        sat_unwind(sat_tlevel-1, 0);
-        if (literal_isfalse(lit_0))
-        {
-            sat_empty = true;
-            debug_step(DEBUG_FAIL, true, new_lits, 1, solver, lineno);
-            sat_action(SAT_ACTION_FAIL);
-        }
-        literal_setmark(lit_0, false);
-        sat_reason_0 = lit_0;
-        debug_step(DEBUG_PROPAGATE, true, new_lits, 1, solver, lineno);
-        sat_action(SAT_ACTION_RESTART);
-        panic("SAT restart failed");
+        literal_t lit = literal_makeindex(i);
+        if (!sat_is_frozen(lit) && sat_pre_value(lit) == 0)
+            order[order_len++] = i;
     }
-
-    // Redundant clause (case 1):
-    literal_t lit_1 = new_lits[1];
-    if (!keep && literal_istrue(lit_0))
+    qsort(order, order_len, sizeof(index_t), sat_pre_var_compare);
+    for (size_t i = 0; i < order_len && !sat_pre_empty; i++)
     {
-        DEBUG("!rLAZY!d %s (!yREDUNDANT!d [true])",
-            sat_show_lits(new_lits, j));
-        goto unmark_and_return;
+        if (sat_pre_value(literal_makeindex(order[i])) != 0)
+            continue;
+        if (sat_pre_eliminate(order[i]))
+            sat_pre_run(&next_unit);
     }
+    gc_free(order);
 
-    // Redundant clause (case 2):
-    if (!keep && literal_isfree(lit_0) && literal_isfree(lit_1) &&
-            sat_clause_istrue(new_lits, j))
+    // Re-attach the remaining clauses:
+    for (size_t i = 0; !sat_pre_empty && i < sat_pre_clauses_len; i++)
     {
-        DEBUG("!rLAZY!d %s (!yREDUNDANT DISJUNCTION!d)",
-            sat_show_lits(new_lits, j));
-        goto unmark_and_return;
+        pre_clause_t clause = sat_pre_clauses[i];
+        if (!clause->deleted)
+            sat_new_clause(clause->lits, clause->length, false);
     }
-
-    // Check for late clauses:
-    if (literal_isfalse(lit_0) && literal_getdlevel(lit_0) != sat_dlevel)
+    if (sat_arena_wasted != 0)
+        sat_compact();
+    bool empty = sat_pre_empty;
+    literal_t units[sat_pre_units_len];
+    size_t units_len = sat_pre_units_len;
+    memcpy(units, sat_pre_units, units_len*sizeof(literal_t));
+
+    // Clean-up:
+    for (size_t i = 0; i < sat_pre_clauses_len; i++)
+        gc_free(sat_pre_clauses[i]);
+    for (size_t i = 0; i < 2*sat_vars_length; i++)
     {
-        panic("at (%s:%zu) late fail clause (!y%s!d); expected level %d, got "
-            "level %d", solver, lineno, sat_show_lits(new_lits, j), sat_dlevel,
-            literal_getdlevel(lit_0));
-        goto unmark_and_return;
+        if (sat_pre_occs[i].clauses != NULL)
+            gc_free(sat_pre_occs[i].clauses);
     }
-    if (literal_isfree(lit_0) && literal_isfalse(lit_1) &&
-        literal_getdlevel(lit_1) != sat_dlevel)
+    if (sat_pre_clauses != NULL)
+        gc_free(sat_pre_clauses);
+    if (sat_pre_queue != NULL)
+        gc_free(sat_pre_queue);
+    gc_free(sat_pre_occs);
+    gc_free(sat_pre_vals);
+    gc_free(sat_pre_units);
+    gc_enable();
+
+    if (empty)
+        return false;
+
+    // Propagate the new units:
+    for (size_t i = 0; i < units_len; i++)
     {
-        panic("at (%s:%zu) late propagation clause (!y%s!d); expected level "
-            "%d, got level %d", solver, lineno, sat_show_lits(new_lits, j),
-            sat_dlevel, literal_getdlevel(lit_1));
-        goto unmark_and_return;
+        literal_t lit = units[i];
+        if (literal_istrue(lit))
+            continue;
+        if (literal_isfalse(lit))
+            return false;
+        debug_step(DEBUG_SELECT, false, &lit, 1, NULL, 0);
+        if (!sat_propagate(lit, SAT_CLAUSE_NONE))
+            return false;
     }
+    return true;
+}
 
-    // Create the clause:
-    stat_clauses++;
-    clause_t clause = (clause_t)gc_malloc(sizeof(struct clause_s) +
-        j*sizeof(literal_t));
-    clause->length = j;
-    check(clause->length > 1);
+/*
+ * Failed literal probing: a literal whose propagation fails at level 1 is
+ * replaced by its negation (learnt by conflict analysis).  Returns false if
+ * the problem is UNSAT.  Only purely propositional problems are probed.
+ */
+static bool sat_probe(void)
+{
+    // Theory solvers may not expect a conflict at level 1 before the search
+    // proper, so only probe purely propositional problems:
+    size_t vars_length = sat_vars_length;
+    for (index_t i = 1; i < vars_length; i++)
+    {
+        if (sat_vars[i].cons != NULL)
+            return true;
+    }
 
-    // Clear the marks:
-    for (size_t i = 0; i < j; i++)
+    size_t budget = SAT_PROBE_LIMIT;
+    for (index_t i = 1; i < vars_length && budget > 0; i++)
     {
-        literal_t lit = new_lits[i];
-        clause->lits[i] = lit;
-        literal_setmark(lit, false);
-        if (!literal_isfree(lit))
+        variable_t var = sat_vars + i;
+        if (var->elim)
+            continue;
+        for (int s = 0; s <= 1; s++)
         {
-            index_t order = literal_getorder(lit);
-            if (order < sat_next_var)
-                sat_next_var = order;
+            literal_t lit = literal_makeindex(i);
+            lit = (s? literal_negate(lit): lit);
+            if (!literal_isfree(lit) ||
+                    literal_getbinary(literal_negate(lit))->length == 0)
+                continue;
+            level_t tlevel = sat_tlevel;
+            sat_dlevel = 1;
+            if (!sat_propagate(lit, SAT_CLAUSE_NONE))
+                return false;
+            size_t work = (size_t)(sat_tlevel - tlevel);
+            budget = (work >= budget? 0: budget - work);
+            if (sat_dlevel == 1)
+                sat_unwind(sat_tlevel-1, 0);
+            else
+            {
+                debug("!cFAILED LITERAL!d %s", sat_show_literal(lit));
+                stat_failed_lits++;
+            }
         }
     }
+    return true;
+}
 
-    // Create watch literals:
-    literal_addwatch(lit_0, clause);
-    literal_addwatch(lit_1, clause);
-
-    // Do any required propagation:
-    if (literal_isfree(lit_0) && literal_isfalse(lit_1))
+/*
+ * Extend the model to the eliminated variables.
+ */
+static void sat_reconstruct(void)
+{
+    size_t i = sat_elim_len;
+    while (i > 0)
     {
-        DEBUG("!rLAZY!d %s (!yPROPAGATE!d %s)", sat_show_clause(clause),
-            sat_show_literal(lit_0));
-        debug_step(DEBUG_PROPAGATE, true, clause->lits, clause->length,
-            solver, lineno);
-        literal_set(lit_0, clause);
-        return;
+        size_t len = (size_t)sat_elim[i-1];
+        literal_t *lits = sat_elim + (i-1-len);
+        i -= len+1;
+        bool sat = false;
+        for (size_t j = 0; !sat && j < len; j++)
+            sat = literal_istrue(lits[j]);
+        if (sat)
+            continue;
+        size_t j;
+        for (j = 0; j < len; j++)
+        {
+            literal_t lit = lits[j];
+            if (literal_isfree(lit) && !sat_is_frozen(lit))
+                break;
+        }
+        if (j >= len)
+            panic("failed to reconstruct eliminated variable %s",
+                sat_show_literal(lits[0]));
+        literal_set(lits[j], SAT_CLAUSE_NONE);
     }
-    if (literal_isfalse(lit_0))
+}
+
+/****************************************************************************/
+/* LOOKAHEAD                                                                */
+/****************************************************************************/
+
+/*
+ * Lookahead splits the problem into cubes (for cube-and-conquer).  It uses a
+ * separate unit propagation over the clauses only: lookahead assignments are
+ * not recorded on the trail and are not seen by the theory solvers.  This is
+ * sound since every clause is implied by the problem.
+ */
+
+// Lookahead state.
+static literal_t *sat_look_trail;   // Lookahead assignments.
+static size_t sat_look_len;         // Length of 'sat_look_trail'.
+static index_t *sat_look_cands;     // Branching candidates.
+static size_t sat_look_cands_len;   // Length of 'sat_look_cands'.
+static uint32_t *sat_look_occs;     // Occurrences (per variable).
+static literal_t *sat_look_prefix;  // Current cube.
+static literal_t *sat_look_cubes;   // All cubes (LITERAL_NIL terminated).
+static size_t sat_look_cubes_len;   // Length of 'sat_look_cubes'.
+static size_t sat_look_num_cubes;   // Number of cubes.
+
+static inline bool sat_look_assign(literal_t lit)
+{
+    if (literal_isfalse(lit))
+        return false;
+    if (literal_istrue(lit))
+        return true;
+    size_t code = literal_getcode(lit);
+    sat_values[code]     = 1;
+    sat_values[code ^ 1] = -1;
+    sat_look_trail[sat_look_len++] = lit;
+    return true;
+}
+static void sat_look_undo(size_t len)
+{
+    while (sat_look_len > len)
     {
-        DEBUG("!rLAZY!d %s (!yFAIL!d)", sat_show_clause(clause));
-        debug_step(DEBUG_FAIL, true, clause->lits, clause->length, solver,
-            lineno);
-        sat_reason = clause;
-        sat_action(SAT_ACTION_FAIL);
-        panic("SAT failure failed");
+        literal_t lit = sat_look_trail[--sat_look_len];
+        size_t code = literal_getcode(lit);
+        sat_values[code]     = 0;
+        sat_values[code ^ 1] = 0;
     }
-    debug_step(DEBUG_PROPAGATE, true, clause->lits, clause->length, solver,
-        lineno);
-    DEBUG("!rLAZY!d %s (!ySLEEP!d)", sat_show_clause(clause));
-    return;
-
-unmark_and_return:
-    for (size_t i = 0; i < j; i++)
-        literal_setmark(new_lits[i], false);
-    return;
 }
-#undef DEBUG
+static int sat_look_cand_compare(const void *a, const void *b)
+{
+    index_t ia = *(index_t *)a, ib = *(index_t *)b;
+    if (sat_look_occs[ia] != sat_look_occs[ib])
+        return (sat_look_occs[ia] > sat_look_occs[ib]? -1: 1);
+    return (ia < ib? -1: 1);
+}
 
 /*
- * Test if a clause is redundant.
+ * Lookahead unit propagation.  Returns false on conflict.  Either way the
+ * assignments are left on the lookahead trail for the caller to undo.
  */
-static bool sat_clause_istrue(literal_t *lits, size_t len)
+static bool sat_look_propagate(literal_t lit)
 {
-    // Search for matching clause:
-    for (size_t i = 0; i < len && literal_isfree(lits[i]); i++)
+    size_t curr = sat_look_len;
+    if (!sat_look_assign(lit))
+        return false;
+    while (curr < sat_look_len)
     {
-        watch_t watch = literal_getwatch(lits[i]);
-        for (size_t j = 0; j < watch->length; j++)
+        lit = literal_negate(sat_look_trail[curr++]);
+
+        // Binary clauses:
+        binary_t binary = literal_getbinary(lit);
+        for (uint32_t i = 0; i < binary->length; i++)
         {
-            clause_t clause = watch->clauses[j];
+            if (!sat_look_assign(binary->lits[i]))
+                return false;
+        }
 
-            // Check if every free literal in clause is free in lits:
-            size_t k;
-            for (k = 0; k < clause->length; k++)
+        // Other clauses:
+        watch_t watch = literal_getwatch(lit);
+        for (int i = 0; i < watch->length; i++)
+        {
+            if (literal_istrue(watch->watchers[i].blocker))
+                continue;
+            clause_ref_t ref = watch->watchers[i].clause;
+            clause_t clause = sat_clause(ref);
+            bool watch_lit_idx = (clause->lits[0] == lit);
+            literal_t watch_lit = clause->lits[watch_lit_idx];
+            if (literal_istrue(watch_lit))
             {
-                literal_t lit = clause->lits[k];
-                if (lit == lits[i])
-                    continue;
-                if (literal_isfalse(lit))
-                    continue;
-                if (literal_istrue(lit))
-                    break;
-                bool found = false;
-                for (size_t l = 0; !found && l < len &&
-                        literal_isfree(lits[l]); l++)
-                    found = (lit == lits[l]);
-                if (!found)
-                    break;
+                watch->watchers[i].blocker = watch_lit;
+                continue;
             }
-            if (k >= clause->length)
+            uint32_t j;
+            for (j = 2; j < clause->length &&
+                    literal_isfalse(clause->lits[j]); j++)
+                ;
+            if (j >= clause->length)
             {
-                debug("SUBSUMED %s BY %s", sat_show_lits(lits, len),
-                    sat_show_clause(clause));
-                return true;
+                if (!sat_look_assign(watch_lit))
+                    return false;
+                continue;
             }
+            literal_t new_watch_lit = clause->lits[j];
+            clause->lits[!watch_lit_idx] = new_watch_lit;
+            clause->lits[j]              = lit;
+            literal_addwatch(new_watch_lit, ref, watch_lit);
+            sat_watch_delete(watch, i);
+            i--;
         }
     }
-    return false;
+    return true;
 }
 
-/****************************************************************************/
-/* WATCHES                                                                  */
-/****************************************************************************/
-
 /*
- * Create a new SAT watch.
+ * Select the branching variable for the current cube.  Each candidate is
+ * propagated both ways, and the variable with the best score (the product
+ * of the number of implied literals) is selected.  Failed literals are
+ * asserted.  Sets 'refuted' if the current cube is refuted.
  */
-static watch_t sat_watch_new(void)
+static literal_t sat_look_select(bool *refuted)
 {
-    size_t watch_size = 4;
-    watch_t watch = (watch_t)gc_malloc(sizeof(struct watch_s) +
-        watch_size*sizeof(clause_t));
-    watch->size   = watch_size;
-    watch->length = 0;
-    return watch;
+    literal_t best;
+    do
+    {
+        best = LITERAL_NIL;
+        double best_score = -1.0;
+        size_t budget = SAT_LOOK_CANDIDATES;
+        for (size_t i = 0; i < sat_look_cands_len && budget > 0; i++)
+        {
+            literal_t lit = literal_makeindex(sat_look_cands[i]);
+            if (!literal_isfree(lit))
+                continue;
+            budget--;
+            size_t len = sat_look_len;
+            bool ok_pos = sat_look_propagate(lit);
+            size_t n_pos = sat_look_len - len;
+            sat_look_undo(len);
+            bool ok_neg = sat_look_propagate(literal_negate(lit));
+            size_t n_neg = sat_look_len - len;
+            sat_look_undo(len);
+            if (!ok_pos || !ok_neg)
+            {
+                // Failed literal:
+                literal_t implied = (ok_pos? lit: literal_negate(lit));
+                if ((!ok_pos && !ok_neg) || !sat_look_propagate(implied))
+                {
+                    *refuted = true;
+                    return LITERAL_NIL;
+                }
+                stat_failed_lits++;
+                continue;
+            }
+            double score = (double)n_pos * (double)n_neg +
+                (double)(n_pos + n_neg);
+            if (score > best_score)
+            {
+                best = lit;
+                best_score = score;
+            }
+        }
+    }
+    while (best != LITERAL_NIL && !literal_isfree(best));
+    return best;
 }
 
 /*
- * Make literal watch clause.
+ * Split the current cube 'depth' more times.
  */
-static void literal_addwatch(literal_t lit, clause_t clause)
+static void sat_look_split(size_t depth, size_t prefix_len)
 {
-    watch_t watch = literal_getwatch(lit);
-    if (watch->length+1 >= watch->size)
+    size_t len = sat_look_len;
+    bool refuted = false;
+    literal_t lit = (depth == 0? LITERAL_NIL: sat_look_select(&refuted));
+    if (refuted)
     {
-        watch->size *= 2;
-        watch = (watch_t)gc_realloc(watch, sizeof(struct watch_s) +
-            watch->size*sizeof(clause_t));
-        literal_setwatch(lit, watch);
+        debug("!cREFUTED CUBE!d %s", sat_show_lits(sat_look_prefix,
+            prefix_len));
+        sat_look_undo(len);
+        return;
     }
-    watch->clauses[watch->length] = clause;
-    watch->length++;
+    if (lit == LITERAL_NIL)
+    {
+        debug("!gCUBE!d %s", sat_show_lits(sat_look_prefix, prefix_len));
+        for (size_t i = 0; i < prefix_len; i++)
+            sat_look_cubes[sat_look_cubes_len++] = sat_look_prefix[i];
+        sat_look_cubes[sat_look_cubes_len++] = LITERAL_NIL;
+        sat_look_num_cubes++;
+        sat_look_undo(len);
+        return;
+    }
+    for (int s = 0; s <= 1; s++)
+    {
+        literal_t branch = (s? literal_negate(lit): lit);
+        size_t len_0 = sat_look_len;
+        sat_look_prefix[prefix_len] = branch;
+        if (sat_look_propagate(branch))
+            sat_look_split(depth-1, prefix_len+1);
+        sat_look_undo(len_0);
+    }
+    sat_look_undo(len);
 }
 
 /*
- * Remove watch from literal.
+ * Split the problem into (at most) 2^depth cubes using lookahead.  Must be
+ * called before solving.  The cubes are stored in 'cubes' as a sequence of
+ * LITERAL_NIL terminated decision lists, and the number of cubes is
+ * returned.  Refuted cubes are omitted, so 0 means the problem is UNSAT.
  */
-static void sat_watch_delete(watch_t watch, uint32_t idx)
+extern size_t sat_cubes(size_t depth, literal_t *cubes)
 {
-    watch->length--;
-    watch->clauses[idx] = watch->clauses[watch->length];
+    check(sat_tlevel == 0);
+    if (sat_empty)
+        return 0;
+
+    size_t size = 0x3FFFFFFF;
+    sat_look_trail = (literal_t *)buffer_alloc(size);
+    sat_look_cands = (index_t *)buffer_alloc(size);
+    sat_look_occs  = (uint32_t *)buffer_alloc(size);
+    sat_look_prefix = (literal_t *)buffer_alloc(size);
+    sat_look_len       = 0;
+    sat_look_cubes     = cubes;
+    sat_look_cubes_len = 0;
+    sat_look_num_cubes = 0;
+
+    // Candidates are ordered by the number of occurrences:
+    memset(sat_look_occs, 0, sat_vars_length * sizeof(uint32_t));
+    for (size_t i = 1; i < sat_vars_length; i++)
+    {
+        literal_t lit = literal_makeindex((index_t)i);
+        sat_look_occs[i] += literal_getbinary(lit)->length +
+            literal_getbinary(literal_negate(lit))->length;
+    }
+    for (size_t ref = sat_arena_start; ref < sat_arena_len; )
+    {
+        clause_t clause = sat_clause(ref);
+        ref += sat_clause_size(clause->length);
+        if (clause->deleted)
+            continue;
+        for (size_t i = 0; i < clause->length; i++)
+            sat_look_occs[literal_getindex(clause->lits[i])]++;
+    }
+    sat_look_cands_len = 0;
+    for (size_t i = 1; i < sat_vars_length; i++)
+    {
+        if (sat_look_occs[i] != 0)
+            sat_look_cands[sat_look_cands_len++] = (index_t)i;
+    }
+    qsort(sat_look_cands, sat_look_cands_len, sizeof(index_t),
+        sat_look_cand_compare);
+
+    // Propagate the units, then split:
+    bool ok = true;
+    for (size_t i = 0; ok && i < sat_vars_length; i++)
+    {
+        for (int s = 0; ok && s <= 1; s++)
+        {
+            literal_t lit = literal_makeindex((index_t)i);
+            lit = (s? literal_negate(lit): lit);
+            if (literal_isunit(lit))
+                ok = sat_look_propagate(lit);
+        }
+    }
+    if (ok)
+        sat_look_split(depth, 0);
+    sat_look_undo(0);
+
+    buffer_free(sat_look_trail, size);
+    buffer_free(sat_look_cands, size);
+    buffer_free(sat_look_occs, size);
+    buffer_free(sat_look_prefix, size);
+    return sat_look_num_cubes;
 }
 
 /***************************************************************************/
@@ -1569,7 +4057,7 @@ extern term_t sat_result(void)
         variable_t var = literal_getvar(lit);
         if (var->lazy && option_verbosity <= 3)
             continue;
-        if (!var->set)
+        if (literal_isfree(lit))
             continue;
         cons_t c = var->cons;
         if (c != NULL && ispurged(c))
@@ -1588,7 +4076,7 @@ extern term_t sat_result(void)
         variable_t var = literal_getvar(lit);
         if (var->lazy && option_verbosity <= 3)
             continue;
-        if (!var->set)
+        if (literal_isfree(lit))
             continue;
         cons_t c = var->cons;
         term_t t;
@@ -1600,7 +4088,7 @@ extern term_t sat_result(void)
                 continue;
             t = solver_convert_cons(c);
         }
-        if (var->sign)
+        if (literal_isfalse(lit))
             t = term_func(make_func(ATOM_NOT, t));
         buf[k++] = t;
     }
@@ -1637,10 +4125,21 @@ extern void sat_dump(void)
         }
         for (size_t j = 0; j < 2; j++)
         {
+            binary_t binary = var->binaries[j];
+            for (size_t k = 0; k < binary->length; k++)
+            {
+                literal_t lit_k = binary->lits[k];
+                if (literal_getindex(lit_k) < i)
+                    continue;
+                variable_t var_k = literal_getvar(lit_k);
+                message("(%s!c%s!d \\/ %s!c%s!d) /\\", (j? "not ": ""),
+                    var->var->name, (literal_getsign(lit_k)? "not ": ""),
+                    var_k->var->name);
+            }
             watch_t watch = var->watches[j];
             for (size_t k = 0; k < watch->length; k++)
             {
-                clause_t clause = watch->clauses[k];
+                clause_t clause = sat_clause(watch->watchers[k].clause);
                 if (clause->lits[0] == lit || clause->lits[0] == -lit)
                 {
                     message_0("(");
@@ -1686,10 +4185,10 @@ static char *sat_show_buf_literal(char *start, char *end, literal_t lit)
         start = show_buf_cons(start, end, c);
         start = show_buf_char(start, end, ']');
     }
-    if (var->set)
+    if (!literal_isfree(lit))
     {
         start = show_buf_str(start, end, " <");
-        start = show_buf_num(start, end, var->dlevel);
+        start = show_buf_num(start, end, literal_getdlevel(lit));
         start = show_buf_char(start, end, '>');
     }
     return start;
@@ -1743,4 +4242,13 @@ static char *sat_show_clause(clause_t clause)
 {
     return sat_show_lits(clause->lits, clause->length);
 }
+static char *sat_show_reason(literal_t lit, clause_ref_t reason)
+{
+    if (reason == sat_deferred_reason)
+        return (char *)"(deferred)";
+    literal_t buf[2];
+    uint32_t len;
+    literal_t *lits = sat_reason_lits(lit, reason, buf, &len);
+    return sat_show_lits(lits, len);
+}
 
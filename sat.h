@@ -46,24 +46,27 @@ enum decision_e
 typedef enum decision_e decision_t;
 
 /*
- * SAT variable (private).
+ * SAT variable (private).  The frequently accessed assignment state (values,
+ * levels, reasons, activities) is stored in separate arrays.
  */
-typedef struct clause_s *clause_t;
 typedef struct watch_s *watch_t;
+typedef struct binary_s *binary_t;
 typedef int level_t;
 struct variable_s
 {
-    bool set:1;                 // Is variable set?
-    bool sign:1;                // If set, what sign?
     bool mark:1;                // Is variable marked?
+    bool poison:1;              // Is variable known to be non-removable?
+    bool elim:1;                // Is variable eliminated?
     bool unit:1;                // Is variable a unit?
     bool unit_sign:1;           // If unit, what sign?
     bool lazy:1;                // Is variable lazily generated?
-    level_t dlevel;             // Decision level.
-    clause_t reason;            // Reason for non-decisions.
+    bool frozen:1;              // Is variable frozen (never eliminated)?
+    unsigned phase:2;           // Saved phase (decision_t).
+    unsigned target:2;          // Target phase (decision_t).
+    unsigned best:2;            // Best phase (decision_t).
+    uint32_t order;             // Heap index.
     watch_t watches[2];         // Watch lists.
-    uint32_t activity;          // Activity.
-    uint32_t order;             // Order index.
+    binary_t binaries[2];       // Binary clause lists.
     cons_t cons;                // Constraint (NULL if none).
     const char *name;           // Name (NULL if none).
     var_t var;                  // Var (for reflection).
@@ -75,6 +78,17 @@ typedef struct variable_s *variable_t;
  */
 extern variable_t sat_vars;
 
+/*
+ * Literal values (private), indexed by literal code: 1 if the literal is
+ * TRUE, -1 if FALSE, and 0 if unset.
+ */
+extern int8_t *sat_values;
+
+/*
+ * Variable decision levels (private).
+ */
+extern level_t *sat_levels;
+
 /****************************************************************************/
 /* LITERALS                                                                 */
 /****************************************************************************/
@@ -99,27 +113,28 @@ static inline variable_t literal_getvar(literal_t lit)
 }
 static inline level_t literal_getdlevel(literal_t lit)
 {
-    variable_t var = literal_getvar(lit);
-    return var->dlevel;
+    index_t idx = literal_getindex(lit);
+    return sat_levels[idx];
 }
 static inline bool literal_getsign(literal_t lit)
 {
     return (lit < 0);
 }
+static inline size_t ALWAYS_INLINE literal_getcode(literal_t lit)
+{
+    return 2*(size_t)literal_getindex(lit) + literal_getsign(lit);
+}
 static inline bool literal_istrue(literal_t lit)
 {
-    variable_t var = literal_getvar(lit);
-    return (var->set && var->sign == literal_getsign(lit));
+    return (sat_values[literal_getcode(lit)] > 0);
 }
 static inline bool literal_isfalse(literal_t lit)
 {
-    variable_t var = literal_getvar(lit);
-    return (var->set && var->sign == !literal_getsign(lit));
+    return (sat_values[literal_getcode(lit)] < 0);
 }
 static inline bool literal_isfree(literal_t lit)
 {
-    variable_t var = literal_getvar(lit);
-    return !var->set;
+    return (sat_values[literal_getcode(lit)] == 0);
 }
 
 /****************************************************************************/
@@ -134,10 +149,10 @@ extern var_t sat_get_var(bvar_t b);
 static inline decision_t ALWAYS_INLINE sat_get_decision(bvar_t b)
 {
     index_t idx = literal_getindex(b);
-    variable_t var = (variable_t)(sat_vars + idx);
-    if (!var->set)
+    int8_t value = sat_values[2*(size_t)idx];
+    if (value == 0)
         return SAT_UNSET;
-    return (var->sign? SAT_NEG: SAT_POS);
+    return (value < 0? SAT_NEG: SAT_POS);
 }
 extern cons_t sat_get_constraint(bvar_t b);
 
@@ -148,6 +163,16 @@ extern cons_t sat_get_constraint(bvar_t b);
 extern void sat_add_clause(literal_t *lits, size_t size, bool keep,
     const char *solver, size_t lineno);
 
+/*
+ * Deferred explanations (see propagate_lazy() in solver.h).
+ */
+#define SAT_EXPLAIN_SIZE        32
+struct reason_s;
+typedef void (*explain_t)(literal_t lit, const void *data,
+    struct reason_s *reason);
+extern void sat_lazy_propagate(literal_t lit, explain_t explain,
+    const void *data, size_t size, const char *solver, size_t lineno);
+
 /****************************************************************************/
 /* LEVELS                                                                   */
 /****************************************************************************/
@@ -167,6 +192,12 @@ extern void sat_init(void);
 extern void sat_reset(void);
 
 extern bool sat_solve(literal_t *choices);
+extern void sat_seed(uint32_t seed);
+extern size_t sat_cubes(size_t depth, literal_t *cubes);
+extern size_t sat_get_model(literal_t *model);
+extern void sat_incremental(void);
+extern void sat_rewind(void);
+extern size_t sat_get_core(literal_t *core);
 
 extern term_t sat_result(void);
 extern void sat_dump(void);
@@ -22,11 +22,13 @@
 #include "backend.h"
 #include "debug.h"
 #include "expr.h"
+#include "names.h"
 #include "options.h"
 #include "pass_cnf.h"
 #include "pass_flatten.h"
 #include "pass_rewrite.h"
 #include "plugin.h"
+#include "portfolio.h"
 #include "smchr.h"
 #include "solver.h"
 
@@ -129,14 +131,11 @@ extern bool smchr_load(const char *name)
 }
 
 /*
- * Execute the given goal.
+ * Compile the given goal into CNF clauses 's' and constraint definitions 'd'.
  */
-extern term_t smchr_execute(const char *filename, size_t lineno, term_t goal)
+static bool smchr_compile(const char *filename, size_t lineno, term_t goal,
+    expr_t *s, expr_t *d)
 {
-    smchr_init();
-    option_debug_on = option_debug;
-    stats_reset();
-
     // (1) Type-checking:
     debug("T: !m%s", show(goal));
     if (option_debug_on)
@@ -148,7 +147,7 @@ extern term_t smchr_execute(const char *filename, size_t lineno, term_t goal)
 
     typeinfo_t tinfo;
     if (!typecheck(filename, lineno, goal, &tinfo))
-        return TERM_NIL;
+        return false;
 
     // (2) Term-to-expression conversion:
     expr_t e = expr_compile(tinfo, goal);
@@ -159,13 +158,12 @@ extern term_t smchr_execute(const char *filename, size_t lineno, term_t goal)
     // (3) Flatten the expression:
     e = pass_flatten_expr(filename, lineno, e);
     if (e == (expr_t)NULL)
-        return TERM_NIL;
+        return false;
     debug("F: !g%s", show(expr_term(e)));
     if (option_debug_on)
         message("[flatten] = !g%s!d", show(expr_term(e)));
 
     // (4) Convert the expression into CNF:
-    expr_t d;
     e = pass_nnf_expr(filename, lineno, e);
     debug("N: !c%s", show(expr_term(e)));
     if (option_debug_on)
@@ -174,16 +172,22 @@ extern term_t smchr_execute(const char *filename, size_t lineno, term_t goal)
     debug("R: !b%s", show(expr_term(e)));
     if (option_debug_on)
         message("[rewrite] = !b%s!d", show(expr_term(e)));
-    pass_cnf_expr(filename, lineno, e, &e, &d);
-    debug("C: !r%s", show(expr_term(e)));
-    debug("D: !r%s", show(expr_term(d)));
+    pass_cnf_expr(filename, lineno, e, s, d);
+    debug("C: !r%s", show(expr_term(*s)));
+    debug("D: !r%s", show(expr_term(*d)));
     if (option_debug_on)
     {
-        message("[CNF_SAT] = !r%s!d", show(expr_term(e)));
-        message("[CNF_def] = !r%s!d", show(expr_term(d)));
+        message("[CNF_SAT] = !r%s!d", show(expr_term(*s)));
+        message("[CNF_def] = !r%s!d", show(expr_term(*d)));
     }
+    return true;
+}
 
-    // (5) (Re)Initialize the solvers:
+/*
+ * (Re)Initialize the solvers.
+ */
+static void smchr_reset_solvers(void)
+{
     solver_t solver;
     for (solverinfoitr_t i = solverinfoitr(solverinfo);
             solverinfo_get(i, NULL, &solver); solverinfo_next(i))
@@ -196,20 +200,42 @@ extern term_t smchr_execute(const char *filename, size_t lineno, term_t goal)
             rst();
         }
     }
+}
+
+/*
+ * Execute the given goal.
+ */
+extern term_t smchr_execute(const char *filename, size_t lineno, term_t goal)
+{
+    smchr_init();
+    smchr_end();
+    option_debug_on = option_debug;
+    stats_reset();
+
+    // (1) Compile the goal:
+    expr_t e, d;
+    if (!smchr_compile(filename, lineno, goal, &e, &d))
+        return TERM_NIL;
+
+    // (2) (Re)Initialize the solvers:
+    smchr_reset_solvers();
 
-    // (6) Load the constraints:
+    // (3) Load the constraints.  Solver state that dies with the goal is
+    //     allocated from the GC arena (see gc_arena_malloc()).
     gc_collect();
+    gc_arena_begin();
     term_t answer = TERM_NIL;
     if (!backend(filename, lineno, e, d))
         goto smchr_execute_cleanup;
 
-    // (7) Execute the compiled goal:
+    // (4) Execute the compiled goal:
     debug_init();
+    solver_profile_reset();
     stats_start();
-    result_t result = solve(NULL);
+    result_t result = portfolio_run();
     stats_stop();
 
-    // (8) Convert the result:
+    // (5) Convert the result:
     switch (result)
     {
         case RESULT_UNKNOWN:
@@ -223,12 +249,219 @@ extern term_t smchr_execute(const char *filename, size_t lineno, term_t goal)
             break;
     }
 
-    // (9) Cleanup:
+    // (6) Cleanup:
 smchr_execute_cleanup:
     solver_reset();
     sat_reset();
+    gc_arena_end();
     gc_collect();
 
     return answer;
 }
 
+/****************************************************************************/
+/* SESSIONS                                                                 */
+/****************************************************************************/
+
+/*
+ * Session state.  Each assumption is guarded by a selector variable, i.e.
+ * (selector -> assumption) is added to the session, and the selector is used
+ * as a choice.  Selectors are cached, so repeated assumptions do not add new
+ * clauses.
+ */
+MAP_DECL(selectors, term_t, var_t, term_compare);
+MAP_DECL(selvars, var_t, term_t, compare_var);
+struct session_s
+{
+    selectors_t selectors;      // Assumption -> selector.
+    selvars_t selvars;          // Selector -> assumption.
+};
+static struct session_s session;
+static bool session_on = false;
+
+/*
+ * Start a new session (if need be).
+ */
+static void smchr_begin(void)
+{
+    static bool init = false;
+
+    if (session_on)
+        return;
+    if (!init)
+    {
+        if (!gc_root(&session, sizeof(session)))
+            panic("failed to register GC root for session");
+        init = true;
+    }
+    smchr_reset_solvers();
+    backend_reset();
+    sat_incremental();
+    session.selectors = selectors_init();
+    session.selvars = selvars_init();
+    session_on = true;
+}
+
+/*
+ * Add the given goal to the session.
+ */
+extern bool smchr_assert(const char *filename, size_t lineno, term_t goal)
+{
+    smchr_init();
+    smchr_begin();
+    option_debug_on = option_debug;
+
+    expr_t e, d;
+    if (!smchr_compile(filename, lineno, goal, &e, &d))
+        return false;
+    return backend_add(filename, lineno, e, d);
+}
+
+/*
+ * Get the selector literal for an assumption.
+ */
+static literal_t smchr_selector(const char *filename, size_t lineno,
+    term_t assumption)
+{
+    var_t x;
+    if (!selectors_search(session.selectors, assumption, &x))
+    {
+        x = make_var(unique_name("A", NULL));
+        term_t goal = term_func(make_func(ATOM_IMPLIES, term_var(x),
+            assumption));
+        expr_t e, d;
+        if (!smchr_compile(filename, lineno, goal, &e, &d) ||
+                !backend_add(filename, lineno, e, d))
+            return LITERAL_NIL;
+        session.selectors = selectors_insert(session.selectors, assumption,
+            x);
+        session.selvars = selvars_insert(session.selvars, x, assumption);
+    }
+    return backend_literal(x);
+}
+
+/*
+ * Split a conjunction of assumptions into 'assumptions' (if not NULL),
+ * starting from index 'i'.  Returns the new index.
+ */
+static size_t smchr_assumptions(term_t goal, term_t *assumptions, size_t i)
+{
+    if (type(goal) == FUNC && func(goal)->atom == ATOM_AND)
+    {
+        i = smchr_assumptions(func(goal)->args[0], assumptions, i);
+        return smchr_assumptions(func(goal)->args[1], assumptions, i);
+    }
+    if (assumptions != NULL)
+        assumptions[i] = goal;
+    return i+1;
+}
+
+/*
+ * Remove the selectors from an answer.
+ */
+static term_t smchr_remove_selectors(term_t answer)
+{
+    term_t t = answer;
+    if (type(t) == FUNC)
+    {
+        func_t f = func(t);
+        if (f->atom == ATOM_AND)
+        {
+            term_t arg1 = smchr_remove_selectors(f->args[0]);
+            term_t arg2 = smchr_remove_selectors(f->args[1]);
+            if (arg1 == TERM_TRUE)
+                return arg2;
+            if (arg2 == TERM_TRUE)
+                return arg1;
+            return term_func(make_func(ATOM_AND, arg1, arg2));
+        }
+        if (f->atom == ATOM_NOT)
+            t = f->args[0];
+    }
+    if (type(t) == VAR && selvars_search(session.selvars, var(t), NULL))
+        return TERM_TRUE;
+    return answer;
+}
+
+/*
+ * Solve the session under the given assumptions.
+ */
+extern term_t smchr_check(const char *filename, size_t lineno, term_t goal,
+    term_t *core)
+{
+    smchr_init();
+    smchr_begin();
+    option_debug_on = option_debug;
+    stats_reset();
+    *core = TERM_TRUE;
+
+    // (1) Collect the assumptions:
+    size_t len = smchr_assumptions(goal, NULL, 0);
+    term_t assumptions[len];
+    literal_t choices[len+1];
+    smchr_assumptions(goal, assumptions, 0);
+    for (size_t i = 0; i < len; i++)
+    {
+        choices[i] = smchr_selector(filename, lineno, assumptions[i]);
+        if (choices[i] == LITERAL_NIL)
+            return TERM_NIL;
+    }
+    choices[len] = LITERAL_NIL;
+
+    // (2) Solve under the assumptions:
+    debug_init();
+    solver_profile_reset();
+    stats_start();
+    result_t result = solver_solve(choices);
+    stats_stop();
+
+    // (3) Convert the result:
+    term_t answer;
+    switch (result)
+    {
+        case RESULT_UNKNOWN:
+            answer = smchr_remove_selectors(result());
+            break;
+        case RESULT_UNSAT:
+        {
+            answer = TERM_FALSE;
+            literal_t lits[len+1];
+            size_t lits_len = sat_get_core(lits);
+            for (size_t i = 0; i < len; i++)
+            {
+                bool found = false;
+                for (size_t j = 0; !found && j < lits_len; j++)
+                    found = (lits[j] == choices[i]);
+                if (!found)
+                    continue;
+                *core = (*core == TERM_TRUE? assumptions[i]:
+                    term_func(make_func(ATOM_AND, *core, assumptions[i])));
+            }
+            break;
+        }
+        default:
+            answer = TERM_NIL;
+            break;
+    }
+
+    // (4) Prepare for the next query:
+    sat_rewind();
+
+    return answer;
+}
+
+/*
+ * End the session.
+ */
+extern void smchr_end(void)
+{
+    if (!session_on)
+        return;
+    session_on = false;
+    session.selectors = selectors_init();
+    session.selvars = selvars_init();
+    backend_reset();
+    solver_reset();
+    sat_reset();
+    gc_collect();
+}
@@ -58,6 +58,26 @@ extern bool smchr_load(const char *name);
  */
 extern term_t smchr_execute(const char *filename, size_t lineno, term_t goal);
 
+/*
+ * Incremental sessions.  A session consists of a base goal that is loaded
+ * once, and many queries solved under different assumptions.  Learnt clauses,
+ * the constraint store and lazily generated clauses persist between the
+ * queries.
+ * - smchr_assert() adds a goal to the base (starting a new session if need
+ *   be).  Returns `false' if the goal could not be loaded.
+ * - smchr_check() solves the session under the assumptions `goal' (a
+ *   conjunction).  The result is the same as smchr_execute().  If the result
+ *   is `false', then `*core' is set to the conjunction of the assumptions
+ *   that participated in the final conflict (an unsat core); or `true' if
+ *   the base goal itself is unsatisfiable.
+ * - smchr_end() ends the session.  Calling smchr_execute() also ends the
+ *   session.
+ */
+extern bool smchr_assert(const char *filename, size_t lineno, term_t goal);
+extern term_t smchr_check(const char *filename, size_t lineno, term_t goal,
+    term_t *core);
+extern void smchr_end(void);
+
 #ifdef __cplusplus
 }
 #endif
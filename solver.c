@@ -161,6 +161,11 @@ extern void solver_register_solver(sym_t sym, uint_t priority, event_t e,
         sym->propinfo[idx].priority = priority;
         sym->propinfo[idx].events   = e;
         sym->propinfo[idx].handler  = handler;
+#ifdef PROPPROF
+        memset(&sym->propinfo[idx].prof, 0, sizeof(struct propprof_s));
+        if (idx == 0)
+            solver_profile_register(sym);
+#endif
         sym->propinfo_len++;
     }
     else
@@ -368,7 +373,7 @@ extern cons_t solver_make_cons(reason_t reason, sym_t sym, term_t *args_0)
 
     // (3) Otherwise create a new constraint:
     size_t numprops = sym->propinfo_len;
-    cons_t c = (cons_t)gc_malloc(sizeof(struct cons_s) +
+    cons_t c = (cons_t)gc_arena_malloc(sizeof(struct cons_s) +
         aty*sizeof(term_t) + numprops*sizeof(struct prop_s));
     c->sym = sym;
     c->b     = sat_make_var(NULL, c);
@@ -654,6 +659,7 @@ extern void solver_init(void)
     solver_init_var();
     solver_init_trail();
     solver_init_store();
+    solver_init_event();
 
     true_cons.sym    = BOOL_TRUE;
     true_cons.b      = LITERAL_TRUE;
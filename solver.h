@@ -136,6 +136,19 @@ typedef struct cons_s *cons_t;
 typedef uint32_t event_t;
 typedef void (*handler_t)(prop_t prop);
 
+/*
+ * Propagator profile (PROPPROF builds only).
+ */
+struct propprof_s
+{
+    size_t wakes;           // Times woken.
+    uint64_t cycles;        // Cycles spent in the handler.
+    size_t propagations;    // Clauses propagated by the handler.
+    size_t failures;        // Failures caused by the handler.
+    size_t kills;           // Times killed.
+    size_t purges;          // Times purged (with its constraint).
+};
+
 /*
  * Propagator information.
  */
@@ -144,6 +157,9 @@ struct propinfo_s
     uint_t priority;    // Propagator's priority.
     event_t events;     // Propagator's events.
     handler_t handler;  // Propagator's handler.
+#ifdef PROPPROF
+    struct propprof_s prof; // Propagator's profile.
+#endif
 };
 typedef struct propinfo_s *propinfo_t;
 
@@ -179,9 +195,14 @@ struct proplist_s
 #define EVENT_FALSE         0x00000002
 #define EVENT_BIND          0x00000004
 #define EVENT_CREATE        0x00000008
+#define EVENT_LB            0x00000010
+#define EVENT_UB            0x00000020
+#define EVENT_FIX           0x00000040
 #define EVENT_NONE          0
 #define EVENT_DECIDE        (EVENT_TRUE | EVENT_FALSE)
 #define EVENT_ALL           (EVENT_TRUE | EVENT_FALSE | EVENT_BIND)
+#define EVENT_BOUNDS        (EVENT_LB | EVENT_UB)
+#define EVENT_VAR           (EVENT_LB | EVENT_UB | EVENT_FIX)
 
 /*
  * Kill a propagator.
@@ -195,15 +216,23 @@ static inline bool ALWAYS_INLINE solver_iskilled(prop_t prop)
 {
     return ((prop->info & FLAG_KILLED) != 0);
 }
+extern void solver_profile_kill(prop_t prop);
 static inline void ALWAYS_INLINE solver_kill(prop_t prop)
 {
     if (solver_iskilled(prop))
         return;
+#ifdef PROPPROF
+    solver_profile_kill(prop);
+#endif
     trail(&prop->info);
     prop->info |= FLAG_KILLED;
 }
 static inline void ALWAYS_INLINE solver_annihilate(prop_t prop)
 {
+#ifdef PROPPROF
+    if (!solver_iskilled(prop))
+        solver_profile_kill(prop);
+#endif
     prop->info |= FLAG_KILLED;
 }
 #define iskilled(prop)      solver_iskilled(prop)
@@ -275,6 +304,27 @@ extern void solver_flush_queue(void);
  */
 extern void solver_reset_prop_queue(void);
 
+/*
+ * Propagator profiling.
+ *
+ * In executables compiled with -D PROPPROF, every propagator records its
+ * wakes, handler cycles, propagations, failures, kills and purges, and the
+ * store records latency histograms for its operations.  The counters are
+ * reset by solver_profile_reset() and printed (according to
+ * option_propprof) by solver_profile_print().  Otherwise these are no-ops.
+ */
+extern void solver_profile_reset(void);
+extern void solver_profile_print(void);
+
+/*
+ * Profiling hooks (private).
+ */
+struct sym_s;
+extern void solver_profile_register(struct sym_s *sym);
+extern void solver_profile_propagate(void);
+extern void solver_profile_abort(bool fail);
+extern void solver_profile_purge(cons_t c);
+
 /*
  * Initialize a propagator (private).
  */
@@ -308,12 +358,14 @@ struct svar_s
     svar_t next;            // Next unified variable.
     int_t lit;              // Justification literal.
     hash_t hash;            // Variable's hash value.
+    svar_t up;              // Union-find parent (self for the root).
  
     conslist_t cs;          // Constraints that use this variable.
     conslist_t tail;        // Tail of 'cs'.
     size_t cs_len;          // Length of 'cs'.
     bool mark;              // Mark for matching.
-    word_t extra[];         // Solver-specific data.
+    word_t extra[] __attribute__((__aligned__(16)));
+                            // Solver-specific data.
 };
 
 /*
@@ -327,13 +379,20 @@ extern var_t solver_make_var(const char *name);
 
 /*
  * Dereference a variable.
+ *
+ * The 'next'/'lit' links form the proof forest used to explain equalities
+ * (see solver_match_vars()), and may be arbitrarily long.  Dereferencing
+ * instead follows the union-find 'up' links, which are compressed (trailed)
+ * by the slow path, so the common case is at most two loads.
  */
+extern var_t solver_deref_var_compress(var_t x0);
 static inline var_t ALWAYS_INLINE solver_deref_var(var_t x0)
 {
     svar_t x = (svar_t)x0;
-    while (x->next != x)
-        x = x->next;
-    return (var_t)x;
+    svar_t y = x->up;
+    if (y == x || y->up == y)
+        return (var_t)y;
+    return solver_deref_var_compress(x0);
 }
 #define deref(x)                solver_deref_var(x)
 
@@ -576,6 +635,34 @@ extern proplist_t solver_delay_user(prop_t prop, proplist_t ps);
 extern void solver_event_user(proplist_t ps);
 #define event(ps)       solver_event_user(ps)
 
+/*
+ * Delay on a variable event.
+ *
+ * delay_var(prop, x, e)
+ *      Wake 'prop' whenever one of the variable events in 'e' (EVENT_LB,
+ *      EVENT_UB or EVENT_FIX) is signalled for 'x'.  Like delay(), this is
+ *      not undone on backtracking.
+ */
+extern void solver_delay_var(prop_t prop, var_t x, event_t e);
+#define delay_var(prop, x, e)   solver_delay_var((prop), (x), (e))
+
+/*
+ * Signal a variable event.
+ *
+ * event_var(x, e)
+ *      Schedule the propagators delayed on any of the events in 'e' for 'x'.
+ *      Solvers that maintain bounds signal EVENT_LB/EVENT_UB when the
+ *      lower/upper bound of 'x' changes, and EVENT_FIX when 'x' becomes
+ *      fixed.
+ */
+extern void solver_event_var(var_t x, event_t e);
+#define event_var(x, e)         solver_event_var((x), (e))
+
+/*
+ * Initialize variable events (private).
+ */
+extern void solver_init_event(void);
+
 /****************************************************************************/
 /* CONSTRAINTS                                                              */
 /****************************************************************************/
@@ -632,6 +719,9 @@ static inline void ALWAYS_INLINE solver_purge(cons_t c)
 {
     if (solver_ispurged(c))
         return;
+#ifdef PROPPROF
+    solver_profile_purge(c);
+#endif
     void *ptr = (void *)&c->flags;
     trail((word_t *)ptr);
     c->flags |= FLAG_DELETED;
@@ -822,6 +912,9 @@ static inline bool ALWAYS_INLINE solver_islate(reason_t reason)
 static inline void ALWAYS_INLINE solver_add_clause(reason_t reason,
     bool keep, const char *solver, size_t lineno)
 {
+#ifdef PROPPROF
+    solver_profile_propagate();
+#endif
     sat_add_clause(reason->lits, reason->len, keep, solver, lineno);
 }
 static inline void ALWAYS_INLINE solver_propagate(reason_t reason,
@@ -867,6 +960,35 @@ static inline void ALWAYS_INLINE solver_redundant(reason_t reason,
         solver_redundant(reason, solver, lineno);                           \
     } while (false)
 
+/*
+ * Propagate with a deferred explanation.
+ *
+ * propagate_lazy(lit, explain, data)
+ *      Sets 'lit' to TRUE without constructing a reason.  The reason is only
+ *      constructed if it is needed during conflict analysis, by calling
+ *      explain(lit, &data, reason), which must push the antecedents of 'lit'
+ *      onto 'reason'.  The payload 'data' (at most EXPLAIN_DATA_SIZE bytes)
+ *      is copied.  The explanation must depend on the payload only, since
+ *      the solver state may have changed by the time it is called.  The
+ *      antecedents must be TRUE when propagate_lazy() is called.
+ */
+#define EXPLAIN_DATA_SIZE       SAT_EXPLAIN_SIZE
+static inline void ALWAYS_INLINE solver_propagate_lazy(literal_t lit,
+    explain_t explain, const void *data, size_t size, const char *solver,
+    size_t lineno)
+{
+#ifdef PROPPROF
+    solver_profile_propagate();
+#endif
+    sat_lazy_propagate(lit, explain, data, size, solver, lineno);
+}
+#define propagate_lazy(lit, explain, data)                                  \
+    do {                                                                    \
+        debug("PROPAGATE (LAZY) %s:%u", __FILE__, __LINE__);                \
+        solver_propagate_lazy((lit), (explain), &(data), sizeof(data),      \
+            __FILE__, __LINE__);                                            \
+    } while (false)
+
 /****************************************************************************/
 /* STORE                                                                    */
 /****************************************************************************/
@@ -893,6 +1015,13 @@ struct conslist_s
 extern void solver_init_store(void);
 extern void solver_reset_store(void);
 
+/*
+ * Reset/print the store latency histograms (private, see
+ * solver_profile_print()).
+ */
+extern void solver_store_profile_reset(void);
+extern void solver_store_profile_print(void);
+
 /*
  * Search for constraints (private).
  */
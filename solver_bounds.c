@@ -35,10 +35,25 @@ struct boundsinfo_s
     bounds_t bs;
     cons_t lb;
     cons_t ub;
-    proplist_t delays;
 };
 typedef struct boundsinfo_s *boundsinfo_t;
 
+/*
+ * Deferred bounds explanation (the reason literals).
+ */
+#define BOUNDS_EXPLAIN_MAX  ((EXPLAIN_DATA_SIZE / sizeof(literal_t)) - 1)
+struct boundsexplain_s
+{
+    uint32_t len;
+    literal_t lits[BOUNDS_EXPLAIN_MAX];
+};
+
+/*
+ * Propagator state: the decisions already delayed on.
+ */
+#define BOUNDS_DELAY_TRUE   0x1
+#define BOUNDS_DELAY_FALSE  0x2
+
 /*
  * var_t interface.
  */
@@ -55,9 +70,11 @@ static cons_t bounds_get_lb_cons(var_t x);
 static cons_t bounds_get_ub_cons(var_t x);
 static void bounds_set_lb_cons(var_t x, cons_t c, num_t lb);
 static void bounds_set_ub_cons(var_t x, cons_t c, num_t ub);
+static void bounds_explain(literal_t lit, const void *data, reason_t reason);
+static void bounds_propagate(reason_t reason, literal_t lit);
 static bounds_t bounds_set_lb(reason_t reason, var_t x, num_t lb);
 static bounds_t bounds_set_ub(reason_t reason, var_t x, num_t ub);
-static void bounds_delay(prop_t prop);
+static void bounds_delay(prop_t prop, event_t ex, event_t ey, event_t ez);
 static void bounds_lb_handler(prop_t prop);
 static void bounds_x_gt_c_handler(prop_t prop);
 static void bounds_x_gt_y_handler(prop_t prop);
@@ -96,7 +113,7 @@ static void bounds_init(void)
     register_solver(EQ_MUL, 3, EVENT_ALL, bounds_x_eq_y_mul_z_handler);
 
     bounds_t bs = {-inf, inf};
-    struct boundsinfo_s template = {bs, NULL, NULL, NULL};
+    struct boundsinfo_s template = {bs, NULL, NULL};
     bounds_offset = alloc_extra(WORD_SIZEOF(struct boundsinfo_s),
         (word_t *)&template);
 }
@@ -183,7 +200,7 @@ static void bounds_set_lb_cons(var_t x, cons_t c, num_t lb)
     info->bs[L] = lb;
     trail(&info->lb);
     info->lb = c;
-    event(info->delays);
+    event_var(x, EVENT_LB | (lb == info->bs[U]? EVENT_FIX: EVENT_NONE));
 
     debug("!gBOUNDS!d %s::%s..%s", show_var(x), show_num(info->bs[L]),
         show_num(info->bs[U]));
@@ -196,12 +213,44 @@ static void bounds_set_ub_cons(var_t x, cons_t c, num_t ub)
     info->bs[U] = ub;
     trail(&info->ub);
     info->ub = c;
-    event(info->delays);
+    event_var(x, EVENT_UB | (ub == info->bs[L]? EVENT_FIX: EVENT_NONE));
 
     debug("!gBOUNDS!d %s::%s..%s", show_var(x), show_num(info->bs[L]),
         show_num(info->bs[U]));
 }
 
+/*
+ * Propagate a bound literal.  Short reasons whose antecedents are all TRUE
+ * are copied into the payload of a deferred explanation, so no clause is
+ * created unless the bound is involved in a conflict.
+ */
+static void bounds_explain(literal_t lit, const void *data, reason_t reason)
+{
+    const struct boundsexplain_s *explain =
+        (const struct boundsexplain_s *)data;
+    for (size_t i = 0; i < explain->len; i++)
+        antecedent(reason, -explain->lits[i]);
+}
+static void bounds_propagate(reason_t reason, literal_t lit)
+{
+    bool lazy = (reason->len <= BOUNDS_EXPLAIN_MAX);
+    for (size_t i = 0; lazy && i < reason->len; i++)
+        lazy = (reason->lits[i] != LITERAL_NIL &&
+            literal_isfalse(reason->lits[i]));
+    if (!lazy)
+    {
+        size_t sp = save(reason);
+        consequent(reason, lit);
+        propagate(reason);
+        restore(reason, sp);
+        return;
+    }
+    struct boundsexplain_s explain;
+    explain.len = reason->len;
+    memcpy(explain.lits, reason->lits, reason->len*sizeof(literal_t));
+    propagate_lazy(lit, bounds_explain, explain);
+}
+
 /*
  * Set the LB/UB
  */
@@ -213,8 +262,7 @@ static bounds_t bounds_set_lb(reason_t reason, var_t x, num_t lb)
         return info->bs;
     size_t sp = save(reason);
     cons_t c = make_cons(reason, LB, term_var(x), term_int(lb));
-    consequent(reason, c->b);
-    propagate(reason);
+    bounds_propagate(reason, c->b);
 
     if (info->bs[U] < lb)
     {
@@ -236,8 +284,7 @@ static bounds_t bounds_set_ub(reason_t reason, var_t x, num_t ub)
         return info->bs;
     size_t sp = save(reason);
     cons_t c = make_cons(reason, LB, term_var(x), term_int(ub+1));
-    consequent(reason, -c->b);
-    propagate(reason);
+    bounds_propagate(reason, -c->b);
 
     if (ub < info->bs[L])
     {
@@ -253,26 +300,28 @@ static bounds_t bounds_set_ub(reason_t reason, var_t x, num_t ub)
 }
 
 /*
- * Delay a propagator.
+ * Delay a propagator on the bound events of its arguments.  The events of
+ * interest depend on the decision, so each polarity is delayed at most once.
  */
-static void bounds_delay(prop_t prop)
+static void bounds_delay(prop_t prop, event_t ex, event_t ey, event_t ez)
 {
-    if ((bool)prop->state)
+    cons_t c = constraint(prop);
+    word_t mask = (decision(c->b) == TRUE? BOUNDS_DELAY_TRUE:
+        BOUNDS_DELAY_FALSE);
+    if ((prop->state & mask) != 0)
         return;
 
-    cons_t c = constraint(prop);
+    event_t es[] = {ex, ey, ez};
     sym_t sym = c->sym;
-    for (size_t i = 0; i < sym->arity; i++)
+    for (size_t i = 0; i < sym->arity && i < sizeof(es)/sizeof(es[0]); i++)
     {
         term_t arg = c->args[i];
-        if (type(arg) != VAR)
+        if (es[i] == EVENT_NONE || type(arg) != VAR)
             continue;
-        var_t x = var(arg);
-        boundsinfo_t info = (boundsinfo_t)extra(x, bounds_offset);
-        info->delays = delay(prop, info->delays);
+        delay_var(prop, var(arg), es[i]);
     }
 
-    prop->state = (word_t)true;
+    prop->state |= mask;
 }
 
 /*
@@ -346,7 +395,6 @@ static void bounds_lb_handler(prop_t prop)
  */
 static void bounds_x_gt_c_handler(prop_t prop)
 {
-    bounds_delay(prop);
     cons_t c = constraint(prop);
     var_t x = var(c->args[X]);
     num_t k = num(c->args[Y]);
@@ -374,7 +422,6 @@ static void bounds_x_gt_c_handler(prop_t prop)
  */
 static void bounds_x_gt_y_handler(prop_t prop)
 {
-    bounds_delay(prop);
     cons_t c = constraint(prop);
     var_t x = var(c->args[X]);
     var_t y = var(c->args[Y]);
@@ -382,6 +429,7 @@ static void bounds_x_gt_y_handler(prop_t prop)
     {
         case TRUE:
         {
+            bounds_delay(prop, EVENT_UB, EVENT_LB, EVENT_NONE);
             reason_t reason_ubx = make_reason(c->b);
             reason_t reason_lby = make_reason(c->b);
             bounds_t bx = bounds_get(NULL, reason_ubx, x);
@@ -395,6 +443,7 @@ static void bounds_x_gt_y_handler(prop_t prop)
         }
         case FALSE:
         {
+            bounds_delay(prop, EVENT_LB, EVENT_UB, EVENT_NONE);
             reason_t reason_lbx = make_reason(-c->b);
             reason_t reason_uby = make_reason(-c->b);
             bounds_t bx = bounds_get(reason_lbx, NULL, x);
@@ -416,7 +465,6 @@ static void bounds_x_gt_y_handler(prop_t prop)
  */
 static void bounds_x_eq_c_handler(prop_t prop)
 {
-    bounds_delay(prop);
     cons_t c = constraint(prop);
     var_t x = var(c->args[X]);
     num_t k = num(c->args[Y]);
@@ -431,6 +479,7 @@ static void bounds_x_eq_c_handler(prop_t prop)
         }
         case FALSE:
         {
+            bounds_delay(prop, EVENT_BOUNDS, EVENT_NONE, EVENT_NONE);
             reason_t reason = make_reason(-c->b);
             num_t lbx = bounds_get_lb(reason, x);
             if (k == lbx)
@@ -451,7 +500,6 @@ static void bounds_x_eq_c_handler(prop_t prop)
  */
 static void bounds_x_eq_y_handler(prop_t prop)
 {
-    bounds_delay(prop);
     cons_t c = constraint(prop);
     var_t x = var(c->args[X]);
     var_t y = var(c->args[Y]);
@@ -465,6 +513,7 @@ static void bounds_x_eq_y_handler(prop_t prop)
     {
         case TRUE:
         {
+            bounds_delay(prop, EVENT_BOUNDS, EVENT_BOUNDS, EVENT_NONE);
             if (by[L] > bx[L])
             {
                 antecedent(reason_lby, c->b);
@@ -489,6 +538,7 @@ static void bounds_x_eq_y_handler(prop_t prop)
         }
         case FALSE:
         {
+            bounds_delay(prop, EVENT_BOUNDS, EVENT_BOUNDS, EVENT_NONE);
             if (bx[L] == bx[U])
             {
                 num_t k = bx[L];
@@ -541,7 +591,6 @@ static void bounds_x_eq_y_handler(prop_t prop)
  */
 static void bounds_x_eq_y_plus_c_handler(prop_t prop)
 {
-    bounds_delay(prop);
     cons_t c = constraint(prop);
     var_t x = var(c->args[X]);
     var_t y = var(c->args[Y]);
@@ -557,6 +606,7 @@ static void bounds_x_eq_y_plus_c_handler(prop_t prop)
     {
         case TRUE:
         {
+            bounds_delay(prop, EVENT_BOUNDS, EVENT_BOUNDS, EVENT_NONE);
             bounds_t bz = by + bc;
             if (bz[L] > bx[L])
             {
@@ -583,6 +633,7 @@ static void bounds_x_eq_y_plus_c_handler(prop_t prop)
         }
         case FALSE:
         {
+            bounds_delay(prop, EVENT_BOUNDS, EVENT_BOUNDS, EVENT_NONE);
             if (bx[L] == bx[U])
             {
                 num_t z = bx[L] - k;
@@ -657,7 +708,6 @@ static inline bounds_t bounds_div_c(bounds_t bx, num_t c)
 }
 static void bounds_x_eq_y_mul_c_handler(prop_t prop)
 {
-    bounds_delay(prop);
     cons_t c = constraint(prop);
     var_t x = var(c->args[X]);
     var_t y = var(c->args[Y]);
@@ -672,6 +722,7 @@ static void bounds_x_eq_y_mul_c_handler(prop_t prop)
     {
         case TRUE:
         {
+            bounds_delay(prop, EVENT_BOUNDS, EVENT_BOUNDS, EVENT_NONE);
             bounds_t bz = bounds_mul_c(by, k);
             if (k < 0)
             {
@@ -713,6 +764,7 @@ static void bounds_x_eq_y_mul_c_handler(prop_t prop)
         }
         case FALSE:
         {
+            bounds_delay(prop, EVENT_BOUNDS, EVENT_BOUNDS, EVENT_NONE);
             if (bx[L] == bx[U])
             {
                 num_t z = bx[L] / k;
@@ -780,7 +832,6 @@ static inline bool bounds_eq(bounds_t bx, bounds_t by)
 }
 static void bounds_x_eq_y_plus_z_handler(prop_t prop)
 {
-    bounds_delay(prop);
     cons_t c = constraint(prop);
     var_t x = var(c->args[X]);
     var_t y = var(c->args[Y]);
@@ -799,6 +850,7 @@ static void bounds_x_eq_y_plus_z_handler(prop_t prop)
     {
         case TRUE:
         {
+            bounds_delay(prop, EVENT_BOUNDS, EVENT_BOUNDS, EVENT_BOUNDS);
             bounds_t bxx = by + bz;
             reason_t reason = make_reason(c->b);
             if (bxx[L] > bx[L])
@@ -907,7 +959,6 @@ static bounds_t bounds_div(bounds_t bx, bounds_t by)
 }
 static void bounds_x_eq_y_mul_z_handler(prop_t prop)
 {
-    bounds_delay(prop);
     cons_t c = constraint(prop);
     var_t x = var(c->args[X]);
     var_t y = var(c->args[Y]);
@@ -926,6 +977,7 @@ static void bounds_x_eq_y_mul_z_handler(prop_t prop)
     {
         case TRUE:
         {
+            bounds_delay(prop, EVENT_BOUNDS, EVENT_BOUNDS, EVENT_BOUNDS);
             bounds_t bxx = bounds_mul(by, bz);
             reason_t reason = make_reason(c->b);
             if (bxx[L] > bx[L])
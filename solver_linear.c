@@ -253,8 +253,9 @@ static void linear_init(void)
     memset(tableau, 0, sizeof(struct tableau_s));
     if (!gc_root(tableau, sizeof(struct tableau_s)))
         panic("failed to set GC root for tableau: %s", strerror(errno));
-    if (!gc_dynamic_root((void **)&tableau->vars, &tableau->vars_len,
-            sizeof(struct varinfo_s)))
+    if (!gc_typed_root((void **)&tableau->vars, &tableau->vars_len,
+            sizeof(struct varinfo_s), gc_layout(struct varinfo_s, x) |
+            gc_layout(struct varinfo_s, row)))
         panic("failed to set GC root for linear vars: %s", strerror(errno));
 }
 
@@ -40,8 +40,37 @@ size_t stat_backtracks;
 size_t stat_clauses;
 size_t stat_decisions;
 size_t stat_pivots;
+size_t stat_reductions;
+size_t stat_reduce_interval;
+size_t stat_kept_clauses;
+size_t stat_compactions;
+size_t stat_duplicate_clauses;
+size_t stat_deleted_explanations;
+size_t stat_deferred;
+size_t stat_explained;
+size_t stat_minimized_lits;
+size_t stat_restarts;
+size_t stat_reused_levels;
+size_t stat_eliminated_vars;
+size_t stat_subsumed_clauses;
+size_t stat_strengthened_clauses;
+size_t stat_failed_lits;
+size_t stat_cubes;
 static size_t stat_time;
 
+/*
+ * Per-cube timings (cube-and-conquer).
+ */
+#define STAT_CUBES_MAX      1024
+struct cube_time_s
+{
+    size_t cube;                // Cube number.
+    const char *result;         // Cube result.
+    size_t time;                // Cube time (ns).
+};
+static struct cube_time_s stat_cube_times[STAT_CUBES_MAX];
+static size_t stat_cube_times_len;
+
 /*
  * Get time.
  */
@@ -76,6 +105,23 @@ extern void stats_reset(void)
     stat_clauses = 0;
     stat_decisions = 0;
     stat_pivots = 0;
+    stat_reductions = 0;
+    stat_reduce_interval = 0;
+    stat_kept_clauses = 0;
+    stat_compactions = 0;
+    stat_duplicate_clauses = 0;
+    stat_deleted_explanations = 0;
+    stat_deferred = 0;
+    stat_explained = 0;
+    stat_minimized_lits = 0;
+    stat_restarts = 0;
+    stat_reused_levels = 0;
+    stat_eliminated_vars = 0;
+    stat_subsumed_clauses = 0;
+    stat_strengthened_clauses = 0;
+    stat_failed_lits = 0;
+    stat_cubes = 0;
+    stat_cube_times_len = 0;
     stat_time = 0;
 }
 
@@ -109,5 +155,41 @@ extern void stats_print(void)
     message("CLAUSES %zu", stat_clauses);
     message("DECISIONS %zu", stat_decisions);
     message("PIVOTS %zu", stat_pivots);
+    message("REDUCTIONS %zu", stat_reductions);
+    message("REDUCE_INTERVAL %zu", stat_reduce_interval);
+    message("KEPT_CLAUSES %zu", stat_kept_clauses);
+    message("COMPACTIONS %zu", stat_compactions);
+    message("DUPLICATE_CLAUSES %zu", stat_duplicate_clauses);
+    message("DELETED_EXPLANATIONS %zu", stat_deleted_explanations);
+    message("DEFERRED_EXPLANATIONS %zu", stat_deferred);
+    message("EXPLAINED %zu", stat_explained);
+    message("MINIMIZED_LITERALS %zu", stat_minimized_lits);
+    message("RESTARTS %zu", stat_restarts);
+    message("REUSED_LEVELS %zu", stat_reused_levels);
+    message("ELIMINATED_VARS %zu", stat_eliminated_vars);
+    message("SUBSUMED_CLAUSES %zu", stat_subsumed_clauses);
+    message("STRENGTHENED_CLAUSES %zu", stat_strengthened_clauses);
+    message("FAILED_LITERALS %zu", stat_failed_lits);
+    message("CUBES %zu", stat_cubes);
+    for (size_t i = 0; i < stat_cube_times_len; i++)
+    {
+        struct cube_time_s *t = stat_cube_times + i;
+        size_t time_in_ms = (size_t)round((double)t->time / (double)1000000);
+        message("CUBE %zu %s %zu", t->cube, t->result, time_in_ms);
+    }
+}
+
+/*
+ * Record the time taken by a cube.
+ */
+extern void stats_cube(size_t cube, const char *result, size_t time)
+{
+    if (stat_cube_times_len >= STAT_CUBES_MAX)
+        return;
+    struct cube_time_s *t = stat_cube_times + stat_cube_times_len;
+    t->cube   = cube;
+    t->result = result;
+    t->time   = time;
+    stat_cube_times_len++;
 }
 
@@ -26,6 +26,22 @@ extern size_t stat_backtracks;
 extern size_t stat_clauses;
 extern size_t stat_decisions;
 extern size_t stat_pivots;
+extern size_t stat_reductions;
+extern size_t stat_reduce_interval;
+extern size_t stat_kept_clauses;
+extern size_t stat_compactions;
+extern size_t stat_duplicate_clauses;
+extern size_t stat_deleted_explanations;
+extern size_t stat_deferred;
+extern size_t stat_explained;
+extern size_t stat_minimized_lits;
+extern size_t stat_restarts;
+extern size_t stat_reused_levels;
+extern size_t stat_eliminated_vars;
+extern size_t stat_subsumed_clauses;
+extern size_t stat_strengthened_clauses;
+extern size_t stat_failed_lits;
+extern size_t stat_cubes;
 
 /*
  * A timer.
@@ -39,5 +55,6 @@ extern void stats_reset(void);
 extern void stats_start(void);
 extern void stats_stop(void);
 extern void stats_print(void);
+extern void stats_cube(size_t cube, const char *result, size_t time);
 
 #endif      /* __STATS_H */
@@ -21,6 +21,10 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifdef PROPPROF
+#include <x86intrin.h>
+#endif
+
 #include "misc.h"
 #include "solver.h"
 
@@ -31,6 +35,7 @@
 #define STORE_MAX_SHIFT     28
 #define STORE_MAX_LEN       (1 << STORE_MAX_SHIFT)
 #define STORE_DELETE_FREQ   16
+#define STORE_MIGRATE_STEP  64
 
 /*
  * Store entry.
@@ -39,11 +44,52 @@ typedef struct entry_s *entry_t;
 struct entry_s
 {
     hash_t key;             // Entry's key.
-    entry_t next;           // Next entry.
     conslist_t cons;        // Entry's constraints.
     conslist_t tail;        // Tail of 'cons'.
 };
 
+/*
+ * Deleted slot marker.
+ */
+#define STORE_DELETED       ((entry_t)1)
+
+/*
+ * Store table.  Open addressing with linear probing.  The 128-bit keys are
+ * kept inline in a separate array, so a probe is a single SSE compare
+ * against the key array; the entry is only loaded on a match (or to detect
+ * empty/deleted slots).
+ */
+struct table_s
+{
+    hash_t *keys;           // Slot keys.
+    entry_t *entries;       // Slot entries (NULL = empty).
+    size_t shift;           // log2(len).
+    size_t len;             // Number of slots.
+    size_t usage;           // Number of live entries.
+    size_t fill;            // Number of live or deleted slots.
+};
+typedef struct table_s *table_t;
+
+/*
+ * Store operation latency histograms (PROPPROF builds only).  Bucket i
+ * counts the operations that took [2^i, 2^(i+1)) cycles.
+ */
+#define STORE_OP_SEARCH     0
+#define STORE_OP_INSERT     1
+#define STORE_OP_MOVE       2
+#define STORE_OP_MAX        3
+#define STORE_HIST_LEN      48
+#ifdef PROPPROF
+static size_t store_hist[STORE_OP_MAX][STORE_HIST_LEN];
+static uint64_t store_hist_max[STORE_OP_MAX];
+static void store_profile_record(size_t op, uint64_t start);
+#define STORE_PROFILE_BEGIN()   uint64_t profile_start = __rdtsc()
+#define STORE_PROFILE_END(op)   store_profile_record((op), profile_start)
+#else
+#define STORE_PROFILE_BEGIN()
+#define STORE_PROFILE_END(op)
+#endif      /* PROPPROF */
+
 /*
  * Move info.
  */
@@ -61,15 +107,19 @@ static void store_insert_constraint(hash_t key, bool primary, cons_t c);
 static void store_delete_constraint(hash_t key);
 static void store_move_entry(hash_t key_old, hash_t key_new);
 static void store_unmove_entry(word_t arg);
-static void store_grow(void);
+static void store_rehash(void);
+static void store_migrate(size_t n);
 
 /*
- * The global store:
+ * The global store.  Rehashing alternates between the two tables, and is
+ * incremental: while 'store_old' is non-NULL, its slots before
+ * 'store_migrate_idx' have been moved to 'store', and the rest are moved a
+ * few at a time by each insert or search.
  */
-static size_t store_shift;
-static size_t store_len;
-static size_t store_usage;
-static entry_t *store;
+static struct table_s store_tables[2];
+static table_t store;
+static table_t store_old;
+static size_t store_migrate_idx;
 
 /*
  * Initialize/reset the store.
@@ -85,34 +135,165 @@ extern void solver_init_store(void)
             "required");
 #endif      /* VINTAGE_AMD64 */
 
-    size_t size = STORE_MAX_LEN*sizeof(entry_t);
-    store = buffer_alloc(size);
-    store_shift = STORE_INIT_SHIFT;
-    store_len = STORE_INIT_LEN;
-    store_usage = 0;
-    if (!gc_dynamic_root((void **)&store, &store_len, sizeof(entry_t)))
-        panic("failed to set GC dynamic root for constraint store: %s",
-            strerror(errno));
+    for (size_t i = 0; i < 2; i++)
+    {
+        table_t table = store_tables + i;
+        table->keys    = buffer_alloc(STORE_MAX_LEN*sizeof(hash_t));
+        table->entries = buffer_alloc(STORE_MAX_LEN*sizeof(entry_t));
+        table->shift   = STORE_INIT_SHIFT;
+        table->len     = 0;
+        table->usage   = 0;
+        table->fill    = 0;
+        if (!gc_dynamic_root((void **)&table->entries, &table->len,
+                sizeof(entry_t)))
+            panic("failed to set GC dynamic root for constraint store: %s",
+                strerror(errno));
+    }
+    store = store_tables;
+    store->len = STORE_INIT_LEN;
+    store_old = NULL;
+    store_migrate_idx = 0;
 }
 extern void solver_reset_store(void)
 {
-    buffer_free(store, store_len*sizeof(entry_t));
-    store_shift = STORE_INIT_SHIFT;
-    store_len = STORE_INIT_LEN;
-    store_usage = 0;
+    for (size_t i = 0; i < 2; i++)
+    {
+        table_t table = store_tables + i;
+        buffer_free(table->keys, table->len*sizeof(hash_t));
+        buffer_free(table->entries, table->len*sizeof(entry_t));
+        table->shift = STORE_INIT_SHIFT;
+        table->len   = 0;
+        table->usage = 0;
+        table->fill  = 0;
+    }
+    store = store_tables;
+    store->len = STORE_INIT_LEN;
+    store_old = NULL;
+    store_migrate_idx = 0;
 }
 
 /*
  * Store primitive operations.
  */
-static inline size_t store_mask(void)
+static inline size_t store_mask(table_t table)
 {
-    return (1 << store_shift) - 1;
+    return table->len - 1;
 }
-static inline size_t store_index(hash_t hash)
+static inline size_t store_index(table_t table, hash_t hash)
 {
     size_t idx = (size_t)hash[0];
-    return idx & store_mask();
+    return idx & store_mask(table);
+}
+
+/*
+ * Probe for the slot of 'key'.  If found, returns the slot of the matching
+ * entry; otherwise returns the first free (deleted or empty) slot.
+ */
+static inline size_t store_probe(table_t table, hash_t key, bool *found)
+{
+    size_t mask = store_mask(table);
+    size_t idx = store_index(table, key), free = SIZE_MAX;
+    while (true)
+    {
+        if (hash_iseq(key, table->keys[idx]))
+        {
+            entry_t entry = table->entries[idx];
+            if (entry != NULL && entry != STORE_DELETED)
+            {
+                *found = true;
+                return idx;
+            }
+        }
+        entry_t entry = table->entries[idx];
+        if (entry == NULL)
+        {
+            *found = false;
+            return (free == SIZE_MAX? idx: free);
+        }
+        if (entry == STORE_DELETED && free == SIZE_MAX)
+            free = idx;
+        idx = (idx + 1) & mask;
+    }
+}
+
+/*
+ * Find an entry.
+ */
+static inline entry_t store_find_entry(hash_t key)
+{
+    bool found;
+    size_t idx = store_probe(store, key, &found);
+    if (found)
+        return store->entries[idx];
+    if (store_old == NULL)
+        return NULL;
+    idx = store_probe(store_old, key, &found);
+    return (found? store_old->entries[idx]: NULL);
+}
+
+/*
+ * Add an entry into the first free slot of its probe sequence.
+ */
+static void store_add_entry(table_t table, entry_t entry)
+{
+    size_t mask = store_mask(table);
+    size_t idx = store_index(table, entry->key);
+    while (table->entries[idx] != NULL && table->entries[idx] != STORE_DELETED)
+        idx = (idx + 1) & mask;
+    if (table->entries[idx] == NULL)
+        table->fill++;
+    table->usage++;
+    table->keys[idx]    = entry->key;
+    table->entries[idx] = entry;
+}
+
+/*
+ * Remove an entry from a table.
+ */
+static bool store_remove_table_entry(table_t table, entry_t entry)
+{
+    size_t mask = store_mask(table);
+    size_t idx = store_index(table, entry->key);
+    while (table->entries[idx] != entry)
+    {
+        if (table->entries[idx] == NULL)
+            return false;
+        idx = (idx + 1) & mask;
+    }
+    table->usage--;
+    size_t next = (idx + 1) & mask;
+    if (table->entries[next] == NULL)
+    {
+        // End of a probe sequence; the slot can be emptied:
+        table->entries[idx] = NULL;
+        table->fill--;
+    }
+    else
+        table->entries[idx] = STORE_DELETED;
+    return true;
+}
+
+/*
+ * Remove an entry.  During migration the entry may still be in the old
+ * table.
+ */
+static void store_remove_entry(entry_t entry)
+{
+    if (store_remove_table_entry(store, entry))
+        return;
+    if (store_old != NULL && store_remove_table_entry(store_old, entry))
+        return;
+    panic("delete failed");
+}
+
+/*
+ * Add an entry to the store, rehashing if it becomes too full.
+ */
+static void store_insert_entry(entry_t entry)
+{
+    store_add_entry(store, entry);
+    if (STORE_GROWTH_FACTOR * store->fill > store->len)
+        store_rehash();
 }
 
 /*
@@ -122,15 +303,11 @@ extern conslist_t solver_store_search(hash_t key)
 {
     debug("!bSEARCH!d [key=%.16llX%.16llX]", key[0], key[1]);
 
-    size_t idx = store_index(key);
-    entry_t entry = store[idx];
-    while (entry != NULL)
-    {
-        if (hash_iseq(key, entry->key))
-            return entry->cons;
-        entry = entry->next;
-    }
-    return NULL;
+    STORE_PROFILE_BEGIN();
+    store_migrate(STORE_MIGRATE_STEP);
+    entry_t entry = store_find_entry(key);
+    STORE_PROFILE_END(STORE_OP_SEARCH);
+    return (entry == NULL? NULL: entry->cons);
 }
 
 /*
@@ -138,7 +315,9 @@ extern conslist_t solver_store_search(hash_t key)
  */
 extern void solver_store_insert_primary(hash_t key, cons_t c)
 {
+    STORE_PROFILE_BEGIN();
     store_insert_constraint(key, true, c);
+    STORE_PROFILE_END(STORE_OP_INSERT);
 }
 
 /*
@@ -155,7 +334,9 @@ extern void solver_store_insert(cons_t c)
         hash_t key = hash_lookup(key_sym, lookup, c);
         debug("!bINSERT!d %s [key=%.16llX%.16llX]", show_cons(c), key[0],
             key[1]);
+        STORE_PROFILE_BEGIN();
         store_insert_constraint(key, false, c);
+        STORE_PROFILE_END(STORE_OP_INSERT);
     }
 }
 
@@ -164,27 +345,7 @@ extern void solver_store_insert(cons_t c)
  */
 static void store_uninsert_entry(word_t arg)
 {
-    store_usage--;
-    entry_t entry = (entry_t)arg;
-    size_t idx = store_index(entry->key);
-    entry_t entry_0 = store[idx];
-    if (entry == entry_0)
-    {
-        store[idx] = entry_0->next;
-        return;
-    }
-    entry_t prev = entry_0;
-    entry_0 = entry_0->next;
-    while (true)
-    {
-        if (entry == entry_0)
-        {
-            prev->next = entry_0->next;
-            return;
-        }
-        prev = entry_0;
-        entry_0 = entry_0->next;
-    }
+    store_remove_entry((entry_t)arg);
 }
 
 /*
@@ -195,38 +356,29 @@ static void store_insert_constraint(hash_t key, bool primary, cons_t c)
     debug("!bSTORE!d %s [key=%.16llX%.16llX] <%s, ...>", show_cons(c), key[0],
         key[1], show_cons(c));
 
-    conslist_t cons_entry = (conslist_t)gc_malloc(sizeof(struct conslist_s));
+    conslist_t cons_entry =
+        (conslist_t)gc_arena_malloc(sizeof(struct conslist_s));
     cons_entry->cons = c;
 
-    size_t idx = store_index(key);
-    entry_t entry_0 = store[idx];
-    entry_t entry = entry_0;
-    while (entry != NULL)
+    store_migrate(STORE_MIGRATE_STEP);
+    entry_t entry = store_find_entry(key);
+    if (entry != NULL)
     {
-        if (hash_iseq(key, entry->key))
-        {
-            cons_entry->next = entry->cons;
-            if (!primary)
-                trail(&entry->cons);
-            entry->cons = cons_entry;
-            return;
-        }
-        entry = entry->next;
+        cons_entry->next = entry->cons;
+        if (!primary)
+            trail(&entry->cons);
+        entry->cons = cons_entry;
+        return;
     }
 
     cons_entry->next = NULL;
-    entry = (entry_t)gc_malloc(sizeof(struct entry_s));
+    entry = (entry_t)gc_arena_malloc(sizeof(struct entry_s));
     entry->key = key;
-    entry->next = entry_0;
     entry->cons = cons_entry;
     entry->tail = cons_entry;
-    store[idx] = entry;
+    store_insert_entry(entry);
     if (!primary)
         trail_func(store_uninsert_entry, (word_t)entry);
-
-    store_usage++;
-    if (STORE_GROWTH_FACTOR * store_usage > store_len)
-        store_grow();
 }
 
 /*
@@ -264,15 +416,7 @@ static void store_delete_constraint(hash_t key)
     // NOTE: It is unsafe to delete the first conslist element, or the entry
     //       itself.
 
-    size_t idx = store_index(key);
-    entry_t entry_0 = store[idx];
-    entry_t entry = entry_0;
-    while (entry != NULL)
-    {
-        if (hash_iseq(key, entry->key))
-            break;
-        entry = entry->next;
-    }
+    entry_t entry = store_find_entry(key);
     if (entry == NULL)
         return;
     conslist_t cs = entry->cons;
@@ -313,6 +457,7 @@ extern void solver_store_move(cons_t c, hash_t xkey_old, hash_t xkey_new)
     hash_t key_sym = hash_sym(c->sym);
 
     debug("!bMOVE!d %s", show_cons(c));
+    STORE_PROFILE_BEGIN();
     hash_t key_old = hash_cons(c);
     hash_t key_new = hash_update_cons(key_sym, c, xkey_old, xkey_new);
     debug("MOVE [%.16llX%.16llX -> %.16llX%.16llX]", key_old[0],
@@ -331,6 +476,7 @@ extern void solver_store_move(cons_t c, hash_t xkey_old, hash_t xkey_new)
             key_old[1], key_new[0], key_new[1]);
         store_move_entry(key_old, key_new);
     }
+    STORE_PROFILE_END(STORE_OP_MOVE);
 }
 
 /*
@@ -339,55 +485,32 @@ extern void solver_store_move(cons_t c, hash_t xkey_old, hash_t xkey_new)
 static void store_move_entry(hash_t key_old, hash_t key_new)
 {
     // Delete from old position:
-    size_t idx = store_index(key_old);
-    entry_t entry = store[idx];
-    entry_t prev = NULL;
-    while (entry != NULL)
-    {
-        if (hash_iseq(key_old, entry->key))
-        {
-            if (prev == NULL)
-                store[idx] = entry->next;
-            else
-                prev->next = entry->next;
-            break;
-        }
-        prev = entry;
-        entry = entry->next;
-    }
-    if (entry == NULL)
+    entry_t entry_old = store_find_entry(key_old);
+    if (entry_old == NULL)
         return;
-
-    entry->next = NULL;
+    store_remove_entry(entry_old);
 
     // Insert into new position:
-    entry_t entry_old = entry;
-    idx = store_index(key_new);
-    entry = store[idx];
-    while (entry != NULL)
+    entry_t entry = store_find_entry(key_new);
+    if (entry != NULL)
     {
-        if (hash_iseq(key_new, entry->key))
-        {
-            // Append to existing entry:
-            conslist_t tail = entry->tail;
-            tail->next = entry_old->cons;
-            entry->tail = entry_old->tail;
-            goto store_move_entry_exit;
-        }
-        entry = entry->next;
+        // Append to existing entry:
+        conslist_t tail = entry->tail;
+        tail->next = entry_old->cons;
+        entry->tail = entry_old->tail;
+    }
+    else
+    {
+        // Copy without appending:
+        entry = (entry_t)gc_arena_malloc(sizeof(struct entry_s));
+        entry->key  = key_new;
+        entry->cons = entry_old->cons;
+        entry->tail = entry_old->tail;
+        store_insert_entry(entry);
     }
 
-    // Copy without appending:
-    entry = (entry_t)gc_malloc(sizeof(struct entry_s));
-    entry->key  = key_new;
-    entry->next = store[idx];
-    entry->cons = entry_old->cons;
-    entry->tail = entry_old->tail;
-    store[idx] = entry;
-
-store_move_entry_exit: {}
-    
-    moveinfo_t info = (moveinfo_t)gc_malloc(sizeof(struct moveinfo_s));
+    moveinfo_t info =
+        (moveinfo_t)gc_arena_malloc(sizeof(struct moveinfo_s));
     info->old = entry_old;
     info->new = entry;
     trail_func((trailfunc_t)store_unmove_entry, (word_t)info);
@@ -399,117 +522,172 @@ store_move_entry_exit: {}
 static void store_unmove_entry(word_t arg)
 {
     moveinfo_t info = (moveinfo_t)arg;
-    
-    // Move the old entry back to it's original position:
     entry_t entry_old = info->old;
-    hash_t key_old = entry_old->key;
-    size_t idx_old = store_index(key_old);
-    entry_old->next = store[idx_old];
-    store[idx_old] = entry_old;
-
-    // Restore the conslist for the new entry:
     entry_t entry_new = info->new;
-    hash_t key_new = entry_new->key;
-    size_t idx_new = store_index(key_new);
+
     if (entry_new->cons == entry_old->cons)
     {
-        entry_t entry = store[idx_new];
-        if (entry == entry_new)
-            store[idx_new] = entry->next;
-        else
-        {
-            entry_t prev = entry;
-            entry = entry->next;
-            while (entry != NULL)
-            {
-                if (entry == entry_new)
-                {
-                    prev->next = entry->next;
-                    return;
-                }
-                prev = entry;
-                entry = entry->next;
-            }
-            panic("delete failed");
-        }
-        return;
+        // The new entry is a copy; remove it:
+        store_remove_entry(entry_new);
     }
-
-    debug("!bUNMOVE!d %p", entry_old->cons);
-    
-    conslist_t cs = entry_new->cons, prev = cs;
-    cs = cs->next;
-    while (cs != entry_old->cons)
+    else
     {
-        check(cs != NULL);
-        prev = cs;
+        // Restore the conslist for the new entry:
+        debug("!bUNMOVE!d %p", entry_old->cons);
+        conslist_t cs = entry_new->cons, prev = cs;
         cs = cs->next;
+        while (cs != entry_old->cons)
+        {
+            check(cs != NULL);
+            prev = cs;
+            cs = cs->next;
+        }
+        prev->next = NULL;
+        entry_new->tail = prev;
     }
-    prev->next = NULL;
-    entry_new->tail = prev;
+
+    // Move the old entry back to it's original position:
+    store_insert_entry(entry_old);
 }
 
 /*
- * In-place store growth.
+ * Start rehashing the store into the other table.  The table grows if more
+ * than half of the filled slots are live; otherwise only the deleted slots
+ * are reclaimed.  The entries are migrated incrementally by store_migrate().
  */
-static void store_grow(void)
+static void store_rehash(void)
 {
-    store_shift++;
-    if (store_shift >= STORE_MAX_SHIFT)
+    // A previous migration must be finished first:
+    if (store_old != NULL)
+        store_migrate(SIZE_MAX);
+
+    table_t old = store;
+    table_t new = (old == store_tables? store_tables + 1: store_tables);
+    new->shift = old->shift;
+    if (2 * STORE_GROWTH_FACTOR * old->usage > old->len)
+        new->shift++;
+    if (new->shift >= STORE_MAX_SHIFT)
         panic("constraint store too big (%zu constraints)", stat_constraints);
-    size_t old_store_len = store_len;
-    store_len *= 2;
-
-    /*
-     * Move entries.  On average only 1/2 of entries need to be moved.
-     */
-    size_t count = 0;
-    for (size_t i = 0; i < old_store_len; i++)
+    new->len   = (1 << new->shift);
+    new->usage = 0;
+    new->fill  = 0;
+
+    debug("!bREHASH!d [%zu -> %zu]", old->len, new->len);
+    store = new;
+    store_old = old;
+    store_migrate_idx = 0;
+}
+
+/*
+ * Migrate (at most) 'n' slots from the old table.  Migrated slots are
+ * marked deleted so that the old table's probe sequences stay intact.
+ */
+static void store_migrate(size_t n)
+{
+    table_t old = store_old;
+    if (old == NULL)
+        return;
+    size_t end = old->len;
+    if (n < end - store_migrate_idx)
+        end = store_migrate_idx + n;
+    for (size_t i = store_migrate_idx; i < end; i++)
     {
-        entry_t entry = store[i], stay = NULL, moved = NULL;
-        while (entry != NULL)
-        {
-            count++;
-            entry_t next = entry->next;
-            if (store_index(entry->key) != i)
-            {
-                debug("!bGROW!d MOVE [key=%.16llX%.16llX]", entry->key[0],
-                    entry->key[1]);
-                entry->next = moved;
-                moved = entry;
-            }
-            else
-            {
-                entry->next = stay;
-                stay = entry;
-            }
-            entry = next;
-        }
-        store[i] = stay;
-        store[old_store_len + i] = moved;
+        entry_t entry = old->entries[i];
+        if (entry == NULL || entry == STORE_DELETED)
+            continue;
+        debug("!bMIGRATE!d [key=%.16llX%.16llX]", entry->key[0],
+            entry->key[1]);
+        old->entries[i] = STORE_DELETED;
+        old->usage--;
+        store_add_entry(store, entry);
     }
-    store_usage = count;
+    store_migrate_idx = end;
+    if (store_migrate_idx < old->len)
+        return;
 
 #ifndef NODEBUG
-    count = 0;
-    for (size_t i = 0; i < store_len; i++)
+    if (old->usage != 0)
+        panic("bad count (expected 0, got %zu)", old->usage);
+#endif
+    buffer_free(old->keys, old->len*sizeof(hash_t));
+    buffer_free(old->entries, old->len*sizeof(entry_t));
+    old->len   = 0;
+    old->usage = 0;
+    old->fill  = 0;
+    store_old = NULL;
+}
+
+#ifdef PROPPROF
+/*
+ * Record the latency of a store operation.
+ */
+static void store_profile_record(size_t op, uint64_t start)
+{
+    uint64_t cycles = __rdtsc() - start;
+    size_t i = (cycles == 0? 0: 63 - __builtin_clzll(cycles));
+    i = (i < STORE_HIST_LEN? i: STORE_HIST_LEN-1);
+    store_hist[op][i]++;
+    if (cycles > store_hist_max[op])
+        store_hist_max[op] = cycles;
+}
+#endif      /* PROPPROF */
+
+/*
+ * Reset the store latency histograms.
+ */
+extern void solver_store_profile_reset(void)
+{
+#ifdef PROPPROF
+    memset(store_hist, 0, sizeof(store_hist));
+    memset(store_hist_max, 0, sizeof(store_hist_max));
+#endif      /* PROPPROF */
+}
+
+/*
+ * Print the store latency histograms.
+ */
+extern void solver_store_profile_print(void)
+{
+#ifdef PROPPROF
+    static const char *names[STORE_OP_MAX] = {"search", "insert", "move"};
+    switch (option_propprof)
     {
-        entry_t entry = store[i];
-        while (entry != NULL)
-        {
-            count++;
-            if (store_index(entry->key) != i)
+        case PROPPROF_TABLE:
+            message("STORE_LATENCY %-8s %24s %12s", "OP", "CYCLES", "COUNT");
+            for (size_t op = 0; op < STORE_OP_MAX; op++)
+            {
+                for (size_t i = 0; i < STORE_HIST_LEN; i++)
+                {
+                    if (store_hist[op][i] == 0)
+                        continue;
+                    char range[32];
+                    snprintf(range, sizeof(range), "%llu-%llu",
+                        1ull << i, (1ull << (i+1)) - 1);
+                    message("STORE_LATENCY %-8s %24s %12zu", names[op],
+                        range, store_hist[op][i]);
+                }
+                message("STORE_LATENCY %-8s %24s %12llu", names[op], "max",
+                    (unsigned long long)store_hist_max[op]);
+            }
+            break;
+        case PROPPROF_JSON:
+            message_0("STORE_LATENCY {");
+            for (size_t op = 0; op < STORE_OP_MAX; op++)
             {
-                panic("bad hash %.16llX%.16llX at wrong index "
-                    "(expected %zu, got %zu)", entry->key[0], entry->key[1],
-                    i, store_index(entry->key));
-                abort();
+                size_t len = STORE_HIST_LEN;
+                while (len > 0 && store_hist[op][len-1] == 0)
+                    len--;
+                message_0("%s\"%s\":{\"max\":%llu,\"log2_cycles\":[",
+                    (op == 0? "": ","), names[op],
+                    (unsigned long long)store_hist_max[op]);
+                for (size_t i = 0; i < len; i++)
+                    message_0("%s%zu", (i == 0? "": ","), store_hist[op][i]);
+                message_0("]}");
             }
-            entry = entry->next;
-        }
+            message("}");
+            break;
+        default:
+            break;
     }
-    if (count != store_usage)
-        panic("bad count (expected %zu, got %zu)", store_usage, count);
-#endif
+#endif      /* PROPPROF */
 }
-
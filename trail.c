@@ -38,12 +38,16 @@ static void *func_max = 0;
  */
 extern void solver_init_trail(void)
 {
+    check(sizeof(struct trailentry_s) % sizeof(void *) == 0);
+
     __solver_trail_len = 0;
     size_t size = sizeof(struct trailentry_s)*0x7FFFFFFF;
     __solver_trail = (trailentry_t)buffer_alloc(size);
-    if (!gc_dynamic_root((void **)&__solver_trail, &__solver_trail_len, 
-            sizeof(struct trailentry_s)))
-        panic("failed to set GC dynamic root for trail: %s",
+    if (!gc_typed_root((void **)&__solver_trail, &__solver_trail_len,
+            sizeof(struct trailentry_s),
+            gc_layout(struct trailentry_s, ptr) |
+            gc_layout(struct trailentry_s, val)))
+        panic("failed to set GC typed root for trail: %s",
             strerror(errno));
 }
 
@@ -71,6 +71,7 @@ extern var_t solver_make_var(const char *name)
     x->next = x;
     x->lit  = LITERAL_TRUE;
     x->hash = hash_new();
+    x->up   = x;
     x->cs   = NULL;
     x->tail = NULL;
     x->cs_len = 0;
@@ -126,6 +127,26 @@ extern void solver_attach_var(var_t x0, cons_t c)
     x->cs_len++;
 }
 
+/*
+ * Dereference a variable (slow path): find the root and compress the path.
+ * The compression is trailed, since the links are undone on backtracking.
+ */
+extern var_t solver_deref_var_compress(var_t x0)
+{
+    svar_t x = (svar_t)x0;
+    svar_t r = x;
+    while (r->up != r)
+        r = r->up;
+    while (x->up != r)
+    {
+        svar_t n = x->up;
+        trail(&x->up);
+        x->up = r;
+        x = n;
+    }
+    return (var_t)r;
+}
+
 /*
  * Bind two variables.
  */
@@ -175,6 +196,10 @@ extern void solver_bind_vars(literal_t lit, var_t x0, var_t y0)
         y->cs_len += x->cs_len;
     }
 
+    // Union x and y:
+    trail(&x->up);
+    x->up = y;
+
     // Link x and y:
     x = (svar_t)x0;
     y = (svar_t)y0;
@@ -209,7 +234,7 @@ extern void solver_bind_vars(literal_t lit, var_t x0, var_t y0)
         x = n;
         lit = nlit;
     }
-    revinfo_t info = (revinfo_t)gc_malloc(sizeof(struct revinfo_s));
+    revinfo_t info = (revinfo_t)gc_arena_malloc(sizeof(struct revinfo_s));
     info->x = x;
     info->y = (svar_t)y0;
     trail_func(var_reverse, (word_t)info);
@@ -251,7 +276,7 @@ static void var_reverse(word_t arg)
     solver_var_verify((var_t)p);
     solver_var_verify((var_t)info->y);
 #endif
-    gc_free(info);
+    gc_arena_free(info);
 }
 
 /*
@@ -377,6 +402,13 @@ solver_var_verify_restart:
 
     if (x->mark)
         panic("variable `%s' is marked", name);
+    svar_t r = x, u = x;
+    while (r->next != r)
+        r = r->next;
+    while (u->up != u)
+        u = u->up;
+    if (r != u)
+        panic("variable `%s' has inconsistent root", name);
     if (x->next == x)
         return;
     literal_t lit = (literal_t)x->lit;